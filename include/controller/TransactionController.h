@@ -1,56 +1,76 @@
-#ifndef TRANSACTIONCONTROLLER_H
-#define TRANSACTIONCONTROLLER_H
-
-#include "../models/Transaction.h"
-#include "../storage/TransactionRepository.h"
-#include "../services/StatisticsService.h"
-#include "../services/NotificationService.h"
-#include "../services/ImportExportService.h"
-#include <memory>
-#include <vector>
-
-struct TransactionDTO {
-    double amount;
-    TransactionType type;
-    time_t date;
-    std::string categoryId;
-    std::string note;
-};
-
-class TransactionController {
-private:
-    std::shared_ptr<TransactionRepository> repository;
-    std::shared_ptr<StatisticsService> statisticsService;
-    std::shared_ptr<NotificationService> notificationService;
-    std::shared_ptr<ImportExportService> importExportService;
-
-public:
-    TransactionController(
-        std::shared_ptr<TransactionRepository> repo,
-        std::shared_ptr<StatisticsService> stats,
-        std::shared_ptr<NotificationService> notif,
-        std::shared_ptr<ImportExportService> importExport
-    );
-    ~TransactionController();
-
-    Transaction create(const TransactionDTO& dto);
-    Transaction edit(const std::string& id, const TransactionDTO& dto);
-    void remove(const std::string& id);
-    std::vector<Transaction> search(const TransactionFilter& filter);
-    std::vector<Transaction> getAll();
-
-    // Statistics
-    std::map<std::string, double> getMonthlyTotals(const DateRange& range);
-    std::map<std::string, double> getCategoryBreakdown(const DateRange& range);
-
-    // Import/Export
-    std::string exportJSON();
-    ImportResult importJSON(const std::string& json);
-    std::string exportCSV();
-
-    // Notifications
-    std::vector<Notification> getNotifications();
-    void registerNotificationListener(NotificationListener listener);
-};
-
-#endif // TRANSACTIONCONTROLLER_H
+#ifndef TRANSACTIONCONTROLLER_H
+#define TRANSACTIONCONTROLLER_H
+
+#include "../models/Transaction.h"
+#include "../storage/TransactionRepository.h"
+#include "../services/StatisticsService.h"
+#include "../services/NotificationService.h"
+#include "../services/ImportExportService.h"
+#include <memory>
+#include <vector>
+
+struct TransactionDTO {
+    Money amount;
+    TransactionType type;
+    time_t date;
+    std::string categoryId;
+    std::string note;
+};
+
+class TransactionController {
+private:
+    std::shared_ptr<TransactionRepository> repository;
+    std::shared_ptr<StatisticsService> statisticsService;
+    std::shared_ptr<NotificationService> notificationService;
+    std::shared_ptr<ImportExportService> importExportService;
+
+public:
+    TransactionController(
+        std::shared_ptr<TransactionRepository> repo,
+        std::shared_ptr<StatisticsService> stats,
+        std::shared_ptr<NotificationService> notif,
+        std::shared_ptr<ImportExportService> importExport
+    );
+    ~TransactionController();
+
+    Transaction create(const TransactionDTO& dto);
+    Transaction edit(const std::string& id, const TransactionDTO& dto);
+    void remove(const std::string& id);
+    std::vector<Transaction> search(const TransactionFilter& filter);
+    std::vector<Transaction> getAll();
+    void forEach(const TransactionVisitor& visitor);
+    size_t count();
+
+    // Statistics
+    std::map<std::string, Money> getMonthlyTotals(const DateRange& range,
+                                                   Granularity granularity = Granularity::MONTH,
+                                                   ExecutionMode mode = ExecutionMode::SERIAL);
+    std::map<std::string, Money> getCategoryBreakdown(const DateRange& range,
+                                                       ExecutionMode mode = ExecutionMode::SERIAL);
+    std::map<std::string, CategoryRollup> getCategoryTree(const DateRange& range,
+                                                          ExecutionMode mode = ExecutionMode::SERIAL);
+
+    // Categories
+    void defineCategory(const Category& category);
+    std::vector<Category> getCategories();
+
+    // Diagnostics
+    MemoryUsage getMemoryUsage();
+
+    // Maintenance
+    size_t compact();
+
+    // Import/Export
+    std::string exportJSON();
+    void exportJSON(OutputSink& sink);
+    ImportResult importJSON(const std::string& json);
+    ImportResult importJSON(InputSource& source);
+    std::string exportCSV();
+    void exportCSV(OutputSink& sink);
+
+    // Notifications
+    std::vector<Notification> getNotifications();
+    void registerNotificationListener(NotificationListener listener);
+};
+
+#endif // TRANSACTIONCONTROLLER_H
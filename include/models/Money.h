@@ -0,0 +1,70 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+// An amount of money as a whole number of minor units: SCALE decimal places,
+// so 12.50 is held as 1250. Adding and subtracting Money is exact, so totals
+// do not drift as rows come and go, and a sum comes out the same in
+// whatever order its terms are added.
+//
+// The ledger keeps every amount at this one scale whatever its currency;
+// currencies with fewer minor digits simply leave the last ones at zero.
+class Money {
+private:
+    int64_t units;
+
+    explicit constexpr Money(int64_t minorUnits) : units(minorUnits) {}
+
+public:
+    static constexpr int SCALE = 2;
+    static constexpr int64_t UNITS_PER_MAJOR = 100;   // 10^SCALE
+
+    // Longest text toChars writes: sign, 17 integer digits, point, SCALE digits
+    static constexpr size_t MAX_CHARS = 24;
+
+    constexpr Money() : units(0) {}
+
+    static constexpr Money fromMinor(int64_t minorUnits) { return Money(minorUnits); }
+
+    // Rounded to the nearest minor unit, halves away from zero. For amounts
+    // stored as double by earlier versions; NaN and values out of range
+    // become zero.
+    static Money fromDouble(double amount);
+
+    // Parses a decimal number such as "12", "-0.5", "1234.56" or "1.5e3"
+    // (the forms JSON and earlier logs use), rounding extra decimal places
+    // to the nearest minor unit, halves away from zero. Returns false,
+    // leaving value as it was, on anything else or on overflow.
+    static bool parse(std::string_view text, Money& value);
+
+    constexpr int64_t minorUnits() const { return units; }
+    double toDouble() const { return static_cast<double>(units) / UNITS_PER_MAJOR; }
+
+    // Plain decimal with exactly SCALE places ("-12.50"), which parse reads
+    // back unchanged. toChars writes it to [first, first + MAX_CHARS) and
+    // returns the end.
+    char* toChars(char* first) const;
+    std::string toString() const;
+
+    constexpr Money operator-() const { return Money(-units); }
+    constexpr Money operator+(Money other) const { return Money(units + other.units); }
+    constexpr Money operator-(Money other) const { return Money(units - other.units); }
+    constexpr Money operator*(int64_t factor) const { return Money(units * factor); }
+    Money& operator+=(Money other) { units += other.units; return *this; }
+    Money& operator-=(Money other) { units -= other.units; return *this; }
+
+    constexpr bool operator==(Money other) const { return units == other.units; }
+    constexpr bool operator!=(Money other) const { return units != other.units; }
+    constexpr bool operator<(Money other) const { return units < other.units; }
+    constexpr bool operator<=(Money other) const { return units <= other.units; }
+    constexpr bool operator>(Money other) const { return units > other.units; }
+    constexpr bool operator>=(Money other) const { return units >= other.units; }
+};
+
+std::ostream& operator<<(std::ostream& out, Money value);
+
+#endif // MONEY_H
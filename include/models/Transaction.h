@@ -1,35 +1,38 @@
-#ifndef TRANSACTION_H
-#define TRANSACTION_H
-
-#include <string>
-#include <ctime>
-
-enum class TransactionType {
-    INCOME,
-    EXPENSE
-};
-
-struct Transaction {
-    std::string id;
-    double amount;
-    TransactionType type;
-    time_t date;
-    std::string categoryId;
-    std::string note;
-    time_t createdAt;
-    time_t updatedAt;
-    bool isDeleted;
-
-    Transaction() : amount(0), type(TransactionType::EXPENSE), date(0), 
-                    createdAt(0), updatedAt(0), isDeleted(false) {}
-
-    Transaction(const std::string& _id, double _amount, TransactionType _type,
-                time_t _date, const std::string& _categoryId, const std::string& _note)
-        : id(_id), amount(_amount), type(_type), date(_date), 
-          categoryId(_categoryId), note(_note), isDeleted(false) {
-        createdAt = time(nullptr);
-        updatedAt = createdAt;
-    }
-};
-
-#endif // TRANSACTION_H
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include "Money.h"
+#include <cstdint>
+#include <string>
+#include <ctime>
+
+enum class TransactionType {
+    INCOME,
+    EXPENSE
+};
+
+struct Transaction {
+    std::string id;
+    Money amount;
+    TransactionType type;
+    time_t date;
+    std::string categoryId;
+    uint32_t categoryCode;   // categoryId's code in the ledger's CategoryRegistry, set when stored
+    std::string note;
+    time_t createdAt;
+    time_t updatedAt;
+    bool isDeleted;
+
+    Transaction() : amount(), type(TransactionType::EXPENSE), date(0), categoryCode(UINT32_MAX),
+                    createdAt(0), updatedAt(0), isDeleted(false) {}
+
+    Transaction(const std::string& _id, Money _amount, TransactionType _type,
+                time_t _date, const std::string& _categoryId, const std::string& _note)
+        : id(_id), amount(_amount), type(_type), date(_date), 
+          categoryId(_categoryId), categoryCode(UINT32_MAX), note(_note), isDeleted(false) {
+        createdAt = time(nullptr);
+        updatedAt = createdAt;
+    }
+};
+
+#endif // TRANSACTION_H
@@ -1,35 +1,70 @@
-#ifndef IMPORTEXPORTSERVICE_H
-#define IMPORTEXPORTSERVICE_H
-
-#include "../models/Transaction.h"
-#include <string>
-#include <vector>
-#include <memory>
-
-struct ImportResult {
-    bool success;
-    int importedCount;
-    std::string errorMessage;
-};
-
-class TransactionRepository;
-
-class ImportExportService {
-private:
-    std::shared_ptr<TransactionRepository> repository;
-
-public:
-    explicit ImportExportService(std::shared_ptr<TransactionRepository> repo);
-    ~ImportExportService();
-
-    std::string exportToJSON() const;
-    ImportResult importFromJSON(const std::string& json);
-    std::string exportToCSV() const;
-    bool importFromCSV(const std::string& csv);
-
-private:
-    std::string transactionToJSON(const Transaction& tx) const;
-    Transaction jsonToTransaction(const std::string& json) const;
-};
-
-#endif // IMPORTEXPORTSERVICE_H
+#ifndef IMPORTEXPORTSERVICE_H
+#define IMPORTEXPORTSERVICE_H
+
+#include "../models/Transaction.h"
+#include "../storage/OutputSink.h"
+#include "../storage/InputSource.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+struct ImportError {
+    size_t record;          // 0-based position in the input array
+    std::string message;
+};
+
+// success is false only when the input as a whole could not be read, in
+// which case nothing is imported. Individually invalid records are skipped
+// and counted, and the first MAX_REPORTED_ERRORS are described.
+struct ImportResult {
+    static const size_t MAX_REPORTED_ERRORS = 1000;
+
+    bool success = false;
+    int importedCount = 0;
+    int rejectedCount = 0;
+    std::string errorMessage;
+    std::vector<ImportError> recordErrors;
+};
+
+class TransactionRepository;
+class ThreadPool;
+
+class ImportExportService {
+private:
+    std::shared_ptr<TransactionRepository> repository;
+
+public:
+    explicit ImportExportService(std::shared_ptr<TransactionRepository> repo);
+    ~ImportExportService();
+
+    // Streaming exports: rows go through the sink's buffer one at a time,
+    // so memory use does not grow with the ledger. The sink is flushed.
+    void exportToJSON(OutputSink& sink) const;
+    void exportToCSV(OutputSink& sink) const;
+
+    // Whole export as one string
+    std::string exportToJSON() const;
+    std::string exportToCSV() const;
+
+    // Reads the array-of-objects format exportToJSON writes, streaming from
+    // the source one record at a time. Unknown keys are ignored. Accepted
+    // records are staged in one repository batch and committed at the end.
+    ImportResult importFromJSON(InputSource& source);
+    ImportResult importFromJSON(const std::string& json);
+
+    // Reads RFC 4180 CSV in the format exportToCSV writes; the header row
+    // is skipped and the timestamp and deletion columns are ignored. The
+    // input is split at record boundaries and the pieces parsed on the pool
+    // (or inline when it is null), then staged in input order. All or
+    // nothing: any malformed or rejected row leaves the repository unchanged.
+    bool importFromCSV(std::string_view csv, ThreadPool* pool = nullptr);
+    bool importFromCSVFile(const std::string& path, ThreadPool* pool = nullptr);
+
+private:
+    void writeTransactionJSON(OutputSink& sink, const Transaction& tx) const;
+    void writeJSONString(OutputSink& sink, const std::string& value) const;
+    void writeCSVField(OutputSink& sink, const std::string& value) const;
+};
+
+#endif // IMPORTEXPORTSERVICE_H
@@ -1,49 +1,142 @@
-#ifndef NOTIFICATIONSERVICE_H
-#define NOTIFICATIONSERVICE_H
-
-#include "../models/Transaction.h"
-#include "../models/Settings.h"
-#include <vector>
-#include <string>
-#include <functional>
-#include <memory>
-
-struct Notification {
-    std::string id;
-    std::string message;
-    std::string type;
-    time_t timestamp;
-    bool isRead;
-
-    Notification() : timestamp(0), isRead(false) {}
-    Notification(const std::string& _id, const std::string& _msg, const std::string& _type)
-        : id(_id), message(_msg), type(_type), timestamp(time(nullptr)), isRead(false) {}
-};
-
-using NotificationListener = std::function<void(const Notification&)>;
-
-class TransactionRepository;
-
-class NotificationService {
-private:
-    std::shared_ptr<TransactionRepository> repository;
-    std::shared_ptr<Settings> settings;
-    std::vector<Notification> notifications;
-    std::vector<NotificationListener> listeners;
-
-public:
-    NotificationService(std::shared_ptr<TransactionRepository> repo,
-                       std::shared_ptr<Settings> _settings);
-    ~NotificationService();
-
-    std::vector<Notification> checkThresholds() const;
-    void registerListener(NotificationListener listener);
-    void notifyListeners(const Notification& notif);
-    std::vector<Notification> getNotifications() const;
-    void markAsRead(const std::string& notificationId);
-
-private:
-    Notification createNotification(const std::string& message, const std::string& type);
-};
-
-#endif // NOTIFICATIONSERVICE_H
+#ifndef NOTIFICATIONSERVICE_H
+#define NOTIFICATIONSERVICE_H
+
+#include "../models/Transaction.h"
+#include "../models/Settings.h"
+#include "../util/CalendarBucketer.h"
+#include "../util/BoundedQueue.h"
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <functional>
+#include <memory>
+
+struct Notification {
+    std::string id;
+    std::string message;
+    std::string type;
+    time_t timestamp;
+    bool isRead;
+
+    Notification() : timestamp(0), isRead(false) {}
+    Notification(const std::string& _id, const std::string& _msg, const std::string& _type)
+        : id(_id), message(_msg), type(_type), timestamp(time(nullptr)), isRead(false) {}
+};
+
+using NotificationListener = std::function<void(const Notification&)>;
+
+enum class DispatchMode {
+    SYNC,   // listeners run inside notifyListeners, on the caller's thread
+    ASYNC   // notifyListeners queues; a worker thread runs the listeners
+};
+
+struct DispatchStats {
+    size_t queueDepth = 0;   // queued, not yet taken by the worker
+    size_t delivered = 0;
+    size_t coalesced = 0;    // repeats of an id within the coalescing window
+    size_t dropped = 0;      // rejected because the queue was full
+};
+
+class TransactionRepository;
+
+class NotificationService {
+private:
+    // Live expenses dated in the current month
+    struct SpendingTotal {
+        Money spent;
+        size_t rows = 0;
+
+        void apply(Money amount, int sign);
+    };
+
+    std::shared_ptr<TransactionRepository> repository;
+    std::shared_ptr<Settings> settings;
+    std::vector<Notification> notifications;
+    mutable std::mutex notificationsMutex;
+    std::vector<NotificationListener> listeners;
+    std::mutex listenersMutex;   // also guards lastDelivered
+
+    // Dispatch. The worker drains the queue in batches; duplicates are
+    // dropped by whichever thread delivers. queue is null in SYNC mode.
+    // Producers copy it and count themselves in under queueMutex, so a mode
+    // switch can take the queue away and wait for pushes already under way
+    // before the worker's final drain.
+    std::atomic<DispatchMode> dispatchMode;
+    std::mutex modeMutex;   // serializes setDispatchMode
+    mutable std::mutex queueMutex;
+    std::condition_variable producersDone;
+    std::shared_ptr<BoundedQueue<Notification>> queue;
+    size_t producers;   // inside tryPush on queue
+    std::thread worker;
+    std::mutex dispatchMutex;
+    std::condition_variable wakeWorker;
+    std::condition_variable queueDrained;
+    std::atomic<bool> workerSleeping;
+    bool stopping;
+    std::atomic<size_t> pending;   // queued or being delivered
+    std::atomic<size_t> deliveredCount;
+    std::atomic<size_t> coalescedCount;
+    std::atomic<size_t> droppedCount;
+    std::atomic<time_t> coalesceWindow;
+    std::unordered_map<std::string, time_t> lastDelivered;   // id -> timestamp
+
+    // Running totals for the current month, kept up to date from repository
+    // mutation deltas and rebuilt from a repository view when the month
+    // rolls over. appliedVersion is the latest change they include; deltas
+    // the rebuild already counted are skipped. Guarded by totalsMutex.
+    size_t subscription;
+    CalendarBucketer calendar;
+    std::mutex totalsMutex;
+    int64_t currentMonth;
+    uint64_t appliedVersion;
+    SpendingTotal monthTotal;
+    std::vector<SpendingTotal> categoryTotals;   // by category code
+
+public:
+    NotificationService(std::shared_ptr<TransactionRepository> repo,
+                       std::shared_ptr<Settings> _settings);
+    ~NotificationService();
+
+    // Compares this month's expenses with the monthly budget and with each
+    // category limit in Settings::reminderThresholds. Costs one lookup per
+    // configured limit, whatever the size of the ledger.
+    std::vector<Notification> checkThresholds();
+    void registerListener(NotificationListener listener);
+    void notifyListeners(const Notification& notif);
+
+    // Switching modes first delivers everything still queued; it is safe
+    // while other threads notify. In ASYNC mode notifyListeners never waits
+    // for listeners: when queueCapacity notifications are waiting, new ones
+    // are dropped and counted.
+    void setDispatchMode(DispatchMode mode, size_t queueCapacity = 1024);
+    DispatchMode getDispatchMode() const { return dispatchMode.load(); }
+
+    // A notification whose id was delivered less than this many seconds
+    // earlier (by Notification::timestamp) is skipped; 0 delivers all
+    void setCoalesceWindow(time_t seconds);
+
+    // Blocks until every queued notification has been delivered or skipped
+    void flush();
+    DispatchStats getDispatchStats() const;
+    std::vector<Notification> getNotifications() const;
+    void markAsRead(const std::string& notificationId);
+
+private:
+    Notification createNotification(const std::string& message, const std::string& type);
+
+    void deliver(const Notification& notif);
+    void dispatchLoop(BoundedQueue<Notification>& queued);
+    void stopWorker();
+
+    void onTransactionChanged(const Transaction* before, const Transaction& after, uint64_t version);
+    // The caller holds totalsMutex
+    void account(const Transaction& tx, int sign);
+    bool rollOver(time_t now);
+};
+
+#endif // NOTIFICATIONSERVICE_H
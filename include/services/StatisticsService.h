@@ -1,36 +1,141 @@
-#ifndef STATISTICSSERVICE_H
-#define STATISTICSSERVICE_H
-
-#include "../models/Transaction.h"
-#include "../models/Category.h"
-#include <map>
-#include <vector>
-#include <memory>
-
-struct DateRange {
-    time_t from;
-    time_t to;
-};
-
-class TransactionRepository;
-
-class StatisticsService {
-private:
-    std::shared_ptr<TransactionRepository> repository;
-
-public:
-    explicit StatisticsService(std::shared_ptr<TransactionRepository> repo);
-    ~StatisticsService();
-
-    std::map<std::string, double> calculateMonthlyTotals(const DateRange& range) const;
-    std::map<std::string, double> categoryBreakdown(const DateRange& range) const;
-    std::map<time_t, double> assetTrend(const DateRange& range) const;
-    double getTotalIncome(const DateRange& range) const;
-    double getTotalExpense(const DateRange& range) const;
-
-private:
-    bool isInDateRange(time_t date, const DateRange& range) const;
-    std::string getMonthKey(time_t timestamp) const;
-};
-
-#endif // STATISTICSSERVICE_H
+#ifndef STATISTICSSERVICE_H
+#define STATISTICSSERVICE_H
+
+#include "../models/Transaction.h"
+#include "../models/Category.h"
+#include "../storage/TransactionColumns.h"
+#include "../util/CalendarBucketer.h"
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include <memory>
+#include <string>
+
+struct DateRange {
+    time_t from;
+    time_t to;
+};
+
+// One category's expenses in a hierarchical breakdown
+struct CategoryRollup {
+    std::optional<std::string> parentId;
+    std::vector<std::string> children;   // those with expenses in the range, in registry order
+    Money own;     // rows filed under the category itself
+    Money total;   // own plus every descendant's
+};
+
+class TransactionRepository;
+class TransactionView;
+class ThreadPool;
+
+// How a report scans the rows it cannot answer from the aggregate cache.
+// Both modes split the scan into the repository's fixed partitions; Money
+// sums are exact, so they return identical results.
+enum class ExecutionMode {
+    SERIAL,     // partitions run one after another on the calling thread
+    PARALLEL    // partitions are spread over the service's thread pool
+};
+
+// Reports may run on any number of threads alongside repository writes.
+// Each one combines the month cache with scans of the repository view the
+// cache was last brought up to, so it reflects a single version.
+class StatisticsService {
+private:
+    // Income/expense totals of the live rows falling into one bucket
+    struct Aggregate {
+        Money income;
+        Money expense;
+        size_t incomeCount = 0;
+        size_t expenseCount = 0;
+
+        void apply(const Transaction& tx, int sign);
+        void merge(const Aggregate& other);
+        bool empty() const { return incomeCount == 0 && expenseCount == 0; }
+    };
+
+    // A date range split into whole cached months and the partial-month
+    // edges that still have to be scanned; each edge lies within one month
+    struct RangeEdge {
+        DateRange range;
+        int64_t month;
+    };
+
+    struct RangePlan {
+        int64_t firstMonth;
+        int64_t lastMonth;
+        std::vector<RangeEdge> edges;
+
+        bool hasMonths() const { return firstMonth <= lastMonth; }
+    };
+
+    std::shared_ptr<TransactionRepository> repository;
+    size_t subscription;
+    std::unique_ptr<ThreadPool> pool;   // null when running single-threaded
+    CalendarBucketer calendar;
+
+    // Maintained from repository mutation deltas, keyed by month id
+    // (year * 12 + month - 1, see CalendarBucketer); the per-category
+    // aggregates of a month are indexed by category code. Guarded by mutex, as
+    // are the version they reflect and the view published at that version.
+    // Mid-way through a bulk insert the cache is ahead of every published
+    // view; reports wait on settled until the two line up again.
+    mutable std::mutex mutex;
+    mutable std::condition_variable settled;
+    std::map<int64_t, Aggregate> monthAggregates;
+    std::map<int64_t, std::vector<Aggregate>> monthCategoryAggregates;
+    uint64_t appliedVersion;
+    std::shared_ptr<const TransactionView> view;
+
+public:
+    // threads sizes the pool used by PARALLEL reports and by the initial
+    // aggregate build; 1 keeps everything on the calling thread
+    explicit StatisticsService(std::shared_ptr<TransactionRepository> repo, size_t threads = 1);
+    ~StatisticsService();
+
+    // Not to be called while reports are running
+    void setThreadCount(size_t threads);
+    size_t getThreadCount() const;
+
+    // Net income per calendar bucket, keyed by its label ("2024-03" for
+    // months; see CalendarBucketer::label for the others)
+    std::map<std::string, Money> calculateMonthlyTotals(const DateRange& range,
+                                                        Granularity granularity = Granularity::MONTH,
+                                                        ExecutionMode mode = ExecutionMode::SERIAL) const;
+    std::map<std::string, Money> categoryBreakdown(const DateRange& range,
+                                                   ExecutionMode mode = ExecutionMode::SERIAL) const;
+
+    // Expenses of the whole category tree (see Category::parentId), every
+    // category with expenses in it or beneath it keyed by id. Costs what
+    // categoryBreakdown does plus one pass over the categories, so drilling
+    // down is a lookup in the result rather than another report.
+    std::map<std::string, CategoryRollup> categoryTreeBreakdown(const DateRange& range,
+                                                                ExecutionMode mode = ExecutionMode::SERIAL) const;
+    std::map<time_t, Money> assetTrend(const DateRange& range,
+                                       ExecutionMode mode = ExecutionMode::SERIAL) const;
+    Money getTotalIncome(const DateRange& range, ExecutionMode mode = ExecutionMode::SERIAL) const;
+    Money getTotalExpense(const DateRange& range, ExecutionMode mode = ExecutionMode::SERIAL) const;
+
+private:
+    bool isInDateRange(time_t date, const DateRange& range) const;
+    ThreadPool* poolFor(ExecutionMode mode) const;
+
+    void rebuildAggregates();
+    void accumulate(const Transaction& tx, int sign);
+    void onTransactionChanged(const Transaction* before, const Transaction& after, uint64_t version);
+    std::shared_ptr<const TransactionView> settledView(std::unique_lock<std::mutex>& lock) const;
+    RangePlan planRange(const DateRange& range) const;
+
+    // Expenses within range by category code, with the view that names the codes
+    std::vector<ColumnSum> expensesByCategoryCode(const DateRange& range, ExecutionMode mode,
+                                                  std::shared_ptr<const TransactionView>& snapshot) const;
+    std::map<int64_t, Money> scanTotals(const TransactionView& snapshot, const DateRange& range,
+                                        Granularity granularity, ExecutionMode mode) const;
+
+    int64_t monthIndex(time_t timestamp) const;
+    time_t monthStart(int64_t month) const;
+};
+
+#endif // STATISTICSSERVICE_H
@@ -0,0 +1,85 @@
+#ifndef BACKUPSTORE_H
+#define BACKUPSTORE_H
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One file as captured for a backup. The mapping keeps the captured bytes
+// readable after the file is renamed over or appended to, so the backup
+// is of the moment of capture however long it takes to write.
+struct BackupSource {
+    std::string name;
+    uint64_t size = 0;
+    int64_t modified = 0;   // last write time, in the file clock's ticks
+    std::shared_ptr<const MappedFile> content;
+};
+
+// What a backup read and stored
+struct BackupStats {
+    std::string generation;
+    size_t files = 0;
+    size_t filesUnchanged = 0;   // same size and write time as in the previous generation
+    uint64_t bytesRead = 0;
+    uint64_t bytesStored = 0;    // chunks not already in the store
+    size_t chunks = 0;
+    size_t chunksStored = 0;
+};
+
+// Incremental, deduplicated backups of a flat directory.
+//
+// A generation is a manifest listing each file's chunks; the chunks are
+// kept once in a content-addressed store shared by all generations. Files
+// are cut at content-defined boundaries, so a file appended to, or edited
+// in the middle, shares every untouched chunk with its earlier versions. A
+// file whose size and write time match the previous generation is not read
+// at all: its chunk list is carried over. Only the newest generations up to
+// the retention count are kept, and chunks no manifest refers to are
+// deleted with them.
+//
+// Chunk names are a 128-bit non-cryptographic hash of the content.
+class BackupStore {
+private:
+    mutable std::mutex mutex;   // one backup, restore or prune at a time
+    std::string root;
+    size_t retention;
+    uint64_t bytesPerSecond;    // 0 = unlimited
+    BackupStats last;
+
+public:
+    explicit BackupStore(const std::string& root, size_t retention = 7);
+
+    // Maps every regular file in dir, skipping subdirectories and temporary
+    // files. The caller keeps the files from changing while this runs.
+    static std::vector<BackupSource> capture(const std::string& dir);
+
+    // Stores the captured files as a new generation and prunes old ones.
+    // Returns the path of its manifest.
+    std::string write(const std::vector<BackupSource>& sources);
+
+    // Generation names, oldest first
+    std::vector<std::string> generations() const;
+
+    // Recreates a generation's files in targetDir, verifying every chunk.
+    // Throws if the generation or a chunk is missing or damaged.
+    void restore(const std::string& generation, const std::string& targetDir) const;
+
+    void setRetention(size_t generations);
+
+    // Caps the bytes a backup reads and writes per second, so it does not
+    // crowd out the storage's own writes
+    void setRateLimit(uint64_t bytesPerSecond);
+
+    BackupStats lastStats() const;
+
+private:
+    std::string manifestPath(const std::string& generation) const;
+    std::string chunkPath(const std::string& hash) const;
+    void prune();
+};
+
+#endif // BACKUPSTORE_H
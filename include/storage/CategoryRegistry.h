@@ -0,0 +1,82 @@
+#ifndef CATEGORYREGISTRY_H
+#define CATEGORYREGISTRY_H
+
+#include "../models/Category.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The category hierarchy over every interned code, flattened for roll-ups:
+// walking postOrder and adding each category's total into its parent's
+// turns per-category totals into subtree totals in one pass.
+struct CategoryTree {
+    std::vector<uint32_t> parents;     // code -> parent code, CategoryRegistry::NONE for roots
+    std::vector<uint32_t> postOrder;   // every code, each after all of its descendants
+};
+
+// Dictionary of category ids and their definitions.
+//
+// Every categoryId the ledger has seen is interned to a dense code: 0, 1,
+// 2... in first-seen order. Codes never change and are never reused, so
+// per-category state can live in flat arrays indexed by code instead of maps
+// keyed by the id string. A Category definition (name, colour, parent) is
+// optional; rows may use ids nobody defined, and those are roots of the
+// category tree.
+//
+// Safe to share between threads: intern and define take an exclusive lock,
+// lookups a shared one.
+class CategoryRegistry {
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, uint32_t> codes;
+    std::shared_ptr<std::vector<std::string>> names;   // code -> categoryId
+    mutable std::atomic<bool> namesShared;              // names was handed out by ids()
+    std::vector<std::optional<Category>> categories;   // code -> definition
+    std::vector<uint32_t> parents;                      // code -> parent code or NONE
+    mutable std::shared_ptr<const CategoryTree> hierarchy;   // null until tree() rebuilds it
+
+public:
+    static constexpr uint32_t NONE = UINT32_MAX;   // code of an id never interned
+
+    CategoryRegistry();
+
+    // Code of categoryId, assigning the next one if it is new
+    uint32_t intern(const std::string& categoryId);
+
+    // Code of categoryId, or NONE
+    uint32_t find(const std::string& categoryId) const;
+
+    // The id a code stands for; empty for codes not yet assigned
+    std::string id(uint32_t code) const;
+    size_t size() const;
+
+    // The code -> id table as it is now. Ids interned later go into a copy,
+    // so the table handed out never changes and can be read without locks.
+    std::shared_ptr<const std::vector<std::string>> ids() const;
+
+    // Adds or replaces the definition of category.id, interning it and its
+    // parent. Throws std::runtime_error, leaving the definition as it was,
+    // if the parent is the category itself or one of its descendants.
+    uint32_t define(const Category& category);
+    std::optional<Category> definition(const std::string& categoryId) const;
+    std::vector<Category> definitions() const;   // in code order
+
+    // The hierarchy as it is now, flattened. Rebuilt on the first call after
+    // a category is interned or redefined; otherwise the same tree is shared.
+    std::shared_ptr<const CategoryTree> tree() const;
+
+    // Definitions as RFC 4180 CSV, one "id,name,color,parentId" record per
+    // category (an empty parentId meaning none), and back. decode defines
+    // each record in turn and returns how many it read; it throws
+    // std::runtime_error on malformed input, keeping the records before it.
+    std::string encodeDefinitions() const;
+    size_t decodeDefinitions(std::string_view csv);
+};
+
+#endif // CATEGORYREGISTRY_H
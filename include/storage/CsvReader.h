@@ -0,0 +1,57 @@
+#ifndef CSVREADER_H
+#define CSVREADER_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+// Record reader for RFC 4180 CSV held in memory (a string or a MappedFile).
+//
+// Fields are separated by commas and records end with CRLF, LF or a bare CR.
+// A field wrapped in double quotes may contain commas, line breaks and
+// doubled quotes; a quote anywhere else is an error. Delimiters are located
+// sixteen bytes at a time with SSE2 where available.
+//
+// Fields are returned as views of the input. The only copies are quoted
+// fields containing doubled quotes, which are unescaped into storage owned
+// by the reader and stay valid until the next call to next().
+class CsvReader {
+private:
+    std::string_view input;
+    size_t position;
+    size_t records;
+
+    std::deque<std::string> unescaped;   // stable addresses for the views
+    size_t unescapedUsed;
+    std::string errorMessage;
+
+public:
+    explicit CsvReader(std::string_view input);
+
+    // Reads the next record. Returns false at the end of the input, or on a
+    // malformed record, in which case error() describes it.
+    bool next(std::vector<std::string_view>& fields);
+
+    const std::string& error() const { return errorMessage; }
+
+    // Bytes consumed so far and records returned so far
+    size_t offset() const { return position; }
+    size_t recordCount() const { return records; }
+
+    // Splits input into at most count pieces for parallel parsing. Returns
+    // their start offsets, the first being 0; every piece starts at a record
+    // boundary. Quote parity up to each split point is counted piecewise on
+    // the pool (or inline when it is null), so a line break inside a quoted
+    // field is never mistaken for the end of a record.
+    static std::vector<size_t> split(std::string_view input, size_t count, ThreadPool* pool = nullptr);
+
+private:
+    bool readQuoted(std::string_view& field);
+    bool fail(const std::string& message);
+};
+
+#endif // CSVREADER_H
@@ -1,27 +1,114 @@
-#ifndef FILESTORAGE_H
-#define FILESTORAGE_H
-
-#include "IStorage.h"
-#include <map>
-
-class FileStorage : public IStorage {
-private:
-    std::map<std::string, std::string> data;
-    std::string storageDir;
-
-public:
-    FileStorage(const std::string& dir = "data");
-    ~FileStorage();
-
-    void save(const std::string& key, const std::string& value) override;
-    std::string load(const std::string& key) override;
-    std::string backup() override;
-    bool exists(const std::string& key) override;
-    void remove(const std::string& key) override;
-
-private:
-    std::string getFilePath(const std::string& key) const;
-    void ensureDirectoryExists();
-};
-
-#endif // FILESTORAGE_H
+#ifndef FILESTORAGE_H
+#define FILESTORAGE_H
+
+#include "IStorage.h"
+#include "BackupStore.h"
+#include "../util/LruCache.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+enum class WriteMode {
+    THROUGH,   // save and append write the file before returning
+    BEHIND     // they queue the write; a flusher thread performs it
+};
+
+// What a write waits for before it counts as done
+enum class SyncPolicy {
+    NONE,   // the OS writes the page cache back when it sees fit
+    DATA,   // fsync each file before it is renamed into place
+    FULL    // also fsync the directory, so the rename itself is durable
+};
+
+// Safe to share between threads: calls touching the same files or the cache
+// are serialized.
+//
+// In write-behind mode save() and append() only update the cache and queue
+// the key. The flusher waits flushDelay for further writes, then writes
+// every queued key once: repeated saves of a key coalesce into one
+// temp-file-and-rename, appends into one append. Keys are written in the
+// order of their latest queued save, or of their first append when none is
+// queued, so a snapshot saved before its log is truncated reaches the disk
+// first. A failed write holds back every key after it and is retried whole;
+// a failed append is cut back off the file first. flush() and the
+// destructor wait until everything queued is on disk.
+//
+// backup() stores the directory as a new generation in a BackupStore under
+// <dir>/backup.
+class FileStorage : public IStorage {
+private:
+    // A queued write: the new content of the file, or bytes to append to it
+    struct PendingWrite {
+        bool replace = false;
+        std::string value;
+        uint64_t order = 0;   // when last saved, or first appended to; writes go out in this order
+    };
+
+    std::mutex mutex;                          // guards cache, the queues and the files written
+    LruCache cache;                            // values saved or loaded, within a byte budget
+    std::string storageDir;
+    WriteMode writeMode;
+    SyncPolicy syncPolicy;
+
+    // Write-behind state
+    std::map<std::string, PendingWrite> pending;    // queued, not yet taken by the flusher
+    std::map<std::string, PendingWrite> flushing;   // being written by the flusher
+    std::set<std::string> removed;                  // keys of flushing removed meanwhile
+    uint64_t nextOrder;
+    uint64_t failedWrites;
+    bool flushRequested;
+    bool stopping;
+    std::chrono::milliseconds flushDelay;
+    std::condition_variable wakeFlusher;
+    std::condition_variable flushed;
+    std::thread flusher;
+
+    BackupStore backupStore;
+
+public:
+    FileStorage(const std::string& dir = "data", WriteMode mode = WriteMode::THROUGH,
+                SyncPolicy sync = SyncPolicy::NONE);
+    ~FileStorage();
+
+    void save(const std::string& key, const std::string& value) override;
+    void append(const std::string& key, const std::string& value) override;
+    std::string load(const std::string& key) override;
+    // Returns the new generation's manifest path, or "" if the backup failed
+    std::string backup() override;
+    bool exists(const std::string& key) override;
+    void remove(const std::string& key) override;
+    std::shared_ptr<const MappedFile> map(const std::string& key) override;
+
+    // Blocks until every queued write is on disk. Throws if a write failed
+    // meanwhile; the failed write stays queued and is retried.
+    void flush() override;
+
+    // How long the flusher lets writes accumulate before writing them
+    void setFlushDelay(std::chrono::milliseconds delay);
+    WriteMode getWriteMode() const { return writeMode; }
+
+    // Bytes of values kept in memory for load(); least recently used
+    // values go first
+    void setCacheBudget(size_t bytes);
+    CacheStats cacheStats();
+
+    // Generations, retention, rate limit and restore
+    BackupStore& backups() { return backupStore; }
+
+private:
+    std::string getFilePath(const std::string& key) const;
+    void ensureDirectoryExists();
+    void writeFile(const std::string& key, const PendingWrite& write) const;
+    void queue(const std::string& key, const std::string& value, bool replace);
+    void flushLoop();
+
+    // Waits, with mutex held through lock, until key is neither queued nor
+    // being written
+    void settle(std::unique_lock<std::mutex>& lock, const std::string& key);
+};
+
+#endif // FILESTORAGE_H
@@ -1,17 +1,36 @@
-#ifndef ISTORAGE_H
-#define ISTORAGE_H
-
-#include <string>
-
-class IStorage {
-public:
-    virtual ~IStorage() = default;
-
-    virtual void save(const std::string& key, const std::string& value) = 0;
-    virtual std::string load(const std::string& key) = 0;
-    virtual std::string backup() = 0;
-    virtual bool exists(const std::string& key) = 0;
-    virtual void remove(const std::string& key) = 0;
-};
-
-#endif // ISTORAGE_H
+#ifndef ISTORAGE_H
+#define ISTORAGE_H
+
+#include "MappedFile.h"
+#include <string>
+#include <memory>
+
+class IStorage {
+public:
+    virtual ~IStorage() = default;
+
+    // save and append throw std::runtime_error when the write fails; the
+    // stored value is then left as it was
+    virtual void save(const std::string& key, const std::string& value) = 0;
+    virtual void append(const std::string& key, const std::string& value) = 0;
+    virtual std::string load(const std::string& key) = 0;
+    virtual std::string backup() = 0;
+    virtual bool exists(const std::string& key) = 0;
+    virtual void remove(const std::string& key) = 0;
+
+    // Returns once every earlier save and append is durable. Storages that
+    // write before returning have nothing to wait for.
+    virtual void flush() {}
+
+    // Read-only view of a stored value. File-backed storages override this
+    // to memory-map the value instead of copying it; returns nullptr when
+    // the key does not exist.
+    virtual std::shared_ptr<const MappedFile> map(const std::string& key) {
+        if (!exists(key)) {
+            return nullptr;
+        }
+        return MappedFile::fromString(load(key));
+    }
+};
+
+#endif // ISTORAGE_H
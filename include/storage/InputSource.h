@@ -0,0 +1,55 @@
+#ifndef INPUTSOURCE_H
+#define INPUTSOURCE_H
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Buffered byte reader for streaming imports, the counterpart of
+// OutputSink. Input is consumed one window at a time: data()/size()
+// describe the bytes currently buffered and refill() replaces them with the
+// next chunk, so memory stays constant however large the input. Sources: a
+// file path, an open file descriptor (left open), an std::istream, or an
+// in-memory string, which is served as a single window without copying.
+//
+// Read failures throw std::runtime_error.
+class InputSource {
+private:
+    enum class Source { FD, STREAM, MEMORY };
+
+    Source source;
+    int fd;
+    bool ownsFd;
+    std::istream* stream;
+
+    std::vector<char> buffer;
+    const char* window;
+    size_t windowSize;
+    size_t consumedBefore;   // bytes in the windows already replaced
+    bool exhausted;
+
+public:
+    static const size_t DEFAULT_BUFFER_SIZE = 256 * 1024;
+
+    explicit InputSource(const std::string& path, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    explicit InputSource(int fd, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    explicit InputSource(std::istream& in, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    explicit InputSource(std::string_view text);
+    ~InputSource();
+
+    InputSource(const InputSource&) = delete;
+    InputSource& operator=(const InputSource&) = delete;
+
+    const char* data() const { return window; }
+    size_t size() const { return windowSize; }
+
+    // Replaces the window with the next chunk; false at end of input
+    bool refill();
+
+    // Offset of the current window's first byte within the whole input
+    size_t windowOffset() const { return consumedBefore; }
+};
+
+#endif // INPUTSOURCE_H
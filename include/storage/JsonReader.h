@@ -0,0 +1,72 @@
+#ifndef JSONREADER_H
+#define JSONREADER_H
+
+#include "InputSource.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Receives parse events in document order. Views passed to key(), string()
+// and number() point into the reader's buffers and are only valid for the
+// duration of the call. Returning false stops the parse.
+class JsonHandler {
+public:
+    virtual ~JsonHandler() {}
+
+    virtual bool startObject() = 0;
+    virtual bool endObject() = 0;
+    virtual bool startArray() = 0;
+    virtual bool endArray() = 0;
+    virtual bool key(std::string_view name) = 0;
+    virtual bool string(std::string_view value) = 0;
+    virtual bool number(std::string_view text) = 0;   // validated JSON number text
+    virtual bool boolean(bool value) = 0;
+    virtual bool null() = 0;
+};
+
+// Single-pass, SAX-style JSON parser over an InputSource (RFC 8259).
+//
+// Input is consumed window by window and never held whole. Strings and
+// numbers that lie inside one window and need no unescaping are passed to
+// the handler as views of the input buffer; the rest are assembled in one
+// reusable scratch string, so steady-state parsing does not allocate.
+// Nesting is tracked on an explicit stack, limited to MAX_DEPTH.
+class JsonReader {
+private:
+    InputSource& source;
+    const char* windowStart;
+    const char* cursor;
+    const char* limit;
+    size_t windowBase;        // input offset of windowStart
+
+    std::string scratch;
+    std::vector<char> containers;   // '{' or '[' per open container
+    std::string errorMessage;
+
+public:
+    static const size_t MAX_DEPTH = 512;
+
+    explicit JsonReader(InputSource& source);
+
+    // Parses one JSON document followed only by whitespace. Returns false on
+    // a syntax error (see error()) or when the handler stops the parse.
+    bool parse(JsonHandler& handler);
+
+    const std::string& error() const { return errorMessage; }
+
+    // Bytes consumed so far
+    size_t offset() const { return windowBase + static_cast<size_t>(cursor - windowStart); }
+
+private:
+    bool fill();
+    int skipWhitespace();
+    int nextChar();
+    bool readString(std::string_view& value);
+    bool readEscape();
+    bool readNumber(std::string_view& text);
+    bool readLiteral(const char* word);
+    bool fail(const std::string& message);
+};
+
+#endif // JSONREADER_H
@@ -0,0 +1,34 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Read-only view of a file's contents. On POSIX systems the file is
+// memory-mapped so opening it costs no copy; elsewhere, and for storages
+// that are not file-backed, the bytes are held in an owned buffer.
+class MappedFile {
+private:
+    const char* bytes;
+    size_t length;
+    std::string buffer;
+    bool mapped;
+
+    MappedFile();
+
+public:
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns nullptr if the file does not exist or cannot be read
+    static std::shared_ptr<MappedFile> open(const std::string& path);
+    static std::shared_ptr<MappedFile> fromString(std::string content);
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,47 @@
+#ifndef NOTEINDEX_H
+#define NOTEINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Inverted index from byte trigrams of transaction notes to row slots.
+//
+// Keyword search is a case-sensitive substring match, so the index works on
+// raw UTF-8 bytes rather than words: every substring of three or more bytes
+// (any single CJK character included) is covered by the trigrams it
+// contains. Posting lists only narrow the candidates; callers still verify
+// the note, which keeps false positives harmless.
+class NoteIndex {
+private:
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;   // sorted slots
+
+public:
+    void add(uint32_t slot, std::string_view note);
+    void remove(uint32_t slot, std::string_view note);
+    void clear();
+
+    // Bytes held by the posting lists and the table over them
+    size_t memoryBytes() const;
+
+    // Splits a search keyword into whitespace-separated terms, all of which
+    // must occur in a matching note
+    static std::vector<std::string> tokenize(const std::string& keyword);
+
+    // Returns false when no term is long enough to be looked up
+    bool isIndexable(const std::vector<std::string>& terms) const;
+
+    // Size of the shortest posting list among the terms' trigrams: an upper
+    // bound on the number of candidates, computed without touching the lists
+    size_t estimate(const std::vector<std::string>& terms) const;
+
+    // Sorted slots whose notes contain every trigram of every term
+    std::vector<uint32_t> candidates(const std::vector<std::string>& terms) const;
+
+private:
+    static std::vector<uint32_t> trigrams(std::string_view text);
+};
+
+#endif // NOTEINDEX_H
@@ -0,0 +1,66 @@
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include "../models/Money.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Buffered byte writer for streaming exports. Output collects in a fixed
+// buffer that is handed to the target whenever it fills, so memory stays
+// constant however much is written. Targets: a file path (created or
+// truncated), an open file descriptor (left open), an std::ostream, or a
+// string to append to. Integers are formatted with std::to_chars.
+//
+// Write failures throw std::runtime_error. The destructor flushes but
+// swallows errors, so call flush() when the outcome matters.
+class OutputSink {
+private:
+    enum class Target { FD, STREAM, STRING };
+
+    Target target;
+    int fd;
+    bool ownsFd;
+    std::ostream* stream;
+    std::string* text;
+
+    std::vector<char> buffer;
+    size_t used;
+    size_t flushedBytes;
+
+public:
+    static const size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    explicit OutputSink(const std::string& path, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    explicit OutputSink(int fd, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    explicit OutputSink(std::ostream& out, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    explicit OutputSink(std::string* out, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    ~OutputSink();
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    void write(const char* data, size_t size);
+    void write(std::string_view text) { write(text.data(), text.size()); }
+    void put(char c) {
+        if (used == buffer.size()) {
+            drain();
+        }
+        buffer[used++] = c;
+    }
+
+    void writeInt(int64_t value);
+    void writeMoney(Money value);     // plain decimal, see Money::toChars
+
+    void flush();
+    size_t bytesWritten() const { return flushedBytes + used; }
+
+private:
+    void drain();
+    void emit(const char* data, size_t size);
+};
+
+#endif // OUTPUTSINK_H
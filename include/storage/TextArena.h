@@ -0,0 +1,95 @@
+#ifndef TEXTARENA_H
+#define TEXTARENA_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Append-only store for the ledger's text. Strings are copied back to back
+// into large blocks, so a stored string costs its bytes and nothing else:
+// no allocation of its own, no allocator header, no capacity slack.
+//
+// Text is never moved or freed while the arena lives; a string_view
+// returned by store() stays valid as long as the arena does. Only one
+// thread may store at a time, but any number may read text stored
+// earlier while it does.
+class TextArena {
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor;
+    size_t remaining;      // free bytes at cursor
+    size_t used;           // bytes handed out by store()
+    size_t reserved;       // bytes of every block
+
+public:
+    static constexpr size_t BLOCK_BYTES = 64 * 1024;
+
+    TextArena();
+    TextArena(const TextArena&) = delete;
+    TextArena& operator=(const TextArena&) = delete;
+
+    // Copies text into the arena. Text over a quarter of a block gets an
+    // exact block of its own rather than wasting the rest of the current one.
+    std::string_view store(std::string_view text);
+
+    size_t bytesUsed() const { return used; }
+    size_t bytesReserved() const { return reserved; }
+};
+
+// A string held in 16 bytes: up to INLINE_CHARS bytes in place, anything
+// longer as a pointer to text in a TextArena. Copying one copies the 16
+// bytes; the arena text it may point to must outlive every copy.
+class CompactText {
+private:
+    // bytes[15] is the length of inline text, or EXTERNAL; external text
+    // keeps its pointer in bytes[0, 8) and its length in bytes[8, 12)
+    char bytes[16];
+
+    static constexpr unsigned char EXTERNAL = 0xFF;
+
+public:
+    static constexpr size_t INLINE_CHARS = 15;
+
+    CompactText() : bytes() {}
+
+    // In place when short enough, otherwise stored in arena
+    static CompactText make(std::string_view text, TextArena& arena) {
+        return text.size() <= INLINE_CHARS ? held(text) : external(arena.store(text));
+    }
+
+    // Refers to text that already lives in an arena, whatever its length
+    static CompactText external(std::string_view stored) {
+        CompactText compact;
+        const char* data = stored.data();
+        uint32_t size = static_cast<uint32_t>(stored.size());
+        std::memcpy(compact.bytes, &data, sizeof(data));
+        std::memcpy(compact.bytes + 8, &size, sizeof(size));
+        compact.bytes[15] = static_cast<char>(EXTERNAL);
+        return compact;
+    }
+
+    bool isInline() const { return static_cast<unsigned char>(bytes[15]) != EXTERNAL; }
+
+    std::string_view view() const {
+        if (isInline()) {
+            return std::string_view(bytes, static_cast<unsigned char>(bytes[15]));
+        }
+        const char* data;
+        uint32_t size;
+        std::memcpy(&data, bytes, sizeof(data));
+        std::memcpy(&size, bytes + 8, sizeof(size));
+        return std::string_view(data, size);
+    }
+
+private:
+    static CompactText held(std::string_view text) {
+        CompactText compact;
+        std::memcpy(compact.bytes, text.data(), text.size());
+        compact.bytes[15] = static_cast<char>(text.size());
+        return compact;
+    }
+};
+
+#endif // TEXTARENA_H
@@ -0,0 +1,61 @@
+#ifndef TRANSACTIONCOLUMNS_H
+#define TRANSACTIONCOLUMNS_H
+
+#include "../models/Transaction.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Result of a filtered sum: the total and how many rows contributed
+struct ColumnSum {
+    Money sum;
+    size_t count = 0;
+};
+
+// Structure-of-arrays copy of a fixed block of rows, tombstones included.
+// Scans that only need amount, date, type, category and the deleted flag
+// read ~22 bytes per row here instead of a whole Transaction. Amounts are
+// Money minor units and categories dense codes assigned by the owner of the
+// block.
+//
+// The filter-and-sum kernels use AVX2 integer lanes when the CPU supports
+// it and a scalar loop otherwise. Integer sums are exact, so both return
+// the same result.
+class TransactionColumns {
+private:
+    std::vector<int64_t> amounts;   // minor units
+    std::vector<int64_t> dates;
+    std::vector<uint8_t> types;
+    std::vector<uint8_t> deletedFlags;
+    std::vector<uint32_t> categoryCodes;
+
+public:
+    explicit TransactionColumns(size_t capacity = 0);
+
+    void set(size_t slot, const Transaction& tx, uint32_t categoryCode);
+    size_t capacity() const { return amounts.size(); }
+    size_t memoryBytes() const;
+
+    Money amount(size_t slot) const { return Money::fromMinor(amounts[slot]); }
+    int64_t date(size_t slot) const { return dates[slot]; }
+    TransactionType type(size_t slot) const { return static_cast<TransactionType>(types[slot]); }
+    bool isDeleted(size_t slot) const { return deletedFlags[slot] != 0; }
+    uint32_t categoryCode(size_t slot) const { return categoryCodes[slot]; }
+
+    // Sum of live rows in slots [begin, end) of the given type dated within
+    // [from, to]; 0 leaves that end of the range open, as in DateRange
+    ColumnSum sumAmounts(time_t from, time_t to, TransactionType type, size_t begin, size_t end) const;
+
+    // Same predicate, added into byCode at each row's category code
+    void sumByCategory(time_t from, time_t to, TransactionType type, size_t begin, size_t end,
+                       std::vector<ColumnSum>& byCode) const;
+
+    // Name of the kernel sumAmounts dispatches to on this machine
+    static const char* kernelName();
+
+    // Makes sumAmounts use the scalar loop even where AVX2 is available, so
+    // the two kernels can be compared on one machine
+    static void setScalarOnly(bool enabled);
+};
+
+#endif // TRANSACTIONCOLUMNS_H
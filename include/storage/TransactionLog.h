@@ -0,0 +1,56 @@
+#ifndef TRANSACTIONLOG_H
+#define TRANSACTIONLOG_H
+
+#include "../models/Transaction.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Write-ahead log record kinds. Every mutation record carries the full
+// post-mutation row so replay is a plain "apply row" operation.
+enum class LogOp : char {
+    GENERATION = 'G',   // first record of a log: snapshot generation it extends
+    BATCH = 'B',        // the next N row records apply together or not at all
+    ADD = 'A',
+    UPDATE = 'U',
+    REMOVE = 'D'
+};
+
+struct LogRecord {
+    LogOp op;
+    uint64_t generation;
+    Transaction tx;
+
+    LogRecord() : op(LogOp::ADD), generation(0) {}
+};
+
+// Encoding of transaction rows and write-ahead log records.
+//
+// A row is the pipe-delimited field list used by the original storage format
+// (id|amount|type|date|categoryId|note|createdAt|updatedAt|isDeleted) with
+// '\\', '|', '\n' and '\r' escaped so free text cannot break the framing.
+// Amounts are written as plain decimals ("12.50"); the shortest-double form
+// earlier versions wrote ("12.5", "1e+06") is still read.
+// A log record is "<op>|<payload>|<crc32>\n"; the CRC covers everything
+// before the last separator so torn or corrupted tails are detected on replay.
+class TransactionLog {
+public:
+    static std::string encodeRow(const Transaction& tx);
+    static bool decodeRow(std::string_view line, Transaction& tx);
+
+    static std::string encodeRecord(LogOp op, const Transaction& tx);
+    static std::string encodeGeneration(uint64_t generation);
+    static std::string encodeBatch(uint64_t count);
+
+    // Calls visitor for each valid record in order and stops at the first
+    // incomplete or corrupted one. Returns the number of bytes consumed, so
+    // callers can tell whether the whole log was intact. BATCH markers are
+    // not passed on: their rows are delivered only if every one is intact.
+    static size_t replay(std::string_view log,
+                         const std::function<void(const LogRecord&)>& visitor);
+
+    static uint32_t crc32(const char* data, size_t length);
+};
+
+#endif // TRANSACTIONLOG_H
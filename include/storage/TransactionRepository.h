@@ -1,39 +1,281 @@
-#ifndef TRANSACTIONREPOSITORY_H
-#define TRANSACTIONREPOSITORY_H
-
-#include "../models/Transaction.h"
-#include "IStorage.h"
-#include <vector>
-#include <memory>
-
-struct TransactionFilter {
-    std::string categoryId;
-    TransactionType* type = nullptr;
-    time_t dateFrom = 0;
-    time_t dateTo = 0;
-    std::string keyword;
-};
-
-class TransactionRepository {
-private:
-    std::shared_ptr<IStorage> storage;
-    std::vector<Transaction> transactions;
-
-public:
-    explicit TransactionRepository(std::shared_ptr<IStorage> _storage);
-    ~TransactionRepository();
-
-    Transaction add(const Transaction& tx);
-    Transaction update(const Transaction& tx);
-    void remove(const std::string& txId);
-    std::vector<Transaction> find(const TransactionFilter& filter) const;
-    Transaction getById(const std::string& id) const;
-    std::vector<Transaction> getAll() const;
-
-private:
-    void loadFromStorage();
-    void saveToStorage();
-    std::string generateId();
-};
-
-#endif // TRANSACTIONREPOSITORY_H
+#ifndef TRANSACTIONREPOSITORY_H
+#define TRANSACTIONREPOSITORY_H
+
+#include "../models/Transaction.h"
+#include "IStorage.h"
+#include "CategoryRegistry.h"
+#include "TransactionLog.h"
+#include "NoteIndex.h"
+#include "TextArena.h"
+#include "TransactionView.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <functional>
+#include <map>
+
+class ThreadPool;
+class TransactionRepository;
+
+struct TransactionFilter {
+    std::string categoryId;
+    TransactionType* type = nullptr;
+    time_t dateFrom = 0;
+    time_t dateTo = 0;
+    std::string keyword;    // whitespace-separated terms, each must occur in the note
+};
+
+// Called after every mutation with the row as it was before and after it;
+// before is null for newly added rows. A removal arrives as an update whose
+// after-row has isDeleted set. version numbers the change: a view includes
+// it exactly when the view's version() is at least this.
+//
+// Observers run on the writing thread once the change is visible to
+// readers, one mutation at a time and in version order. They may read from
+// the repository but must not write to it or (un)subscribe.
+using TransactionObserver = std::function<void(const Transaction* before, const Transaction& after,
+                                               uint64_t version)>;
+
+// A bulk insert session opened with TransactionRepository::beginBatch().
+// add() checks and stages a row; nothing becomes visible to readers,
+// observers or storage until commit(), which applies the whole batch at
+// once. A batch destroyed without committing is discarded.
+class TransactionBatch {
+private:
+    friend class TransactionRepository;
+
+    TransactionRepository& repository;
+    std::vector<Transaction> rows;
+    std::unordered_set<std::string> ids;   // ids claimed by the staged rows
+
+    explicit TransactionBatch(TransactionRepository& repo) : repository(repo) {}
+
+public:
+    // Assigns an id if the row has none. Throws, leaving the batch as it
+    // was, if the id belongs to a live row or to another staged row. A batch
+    // is not itself thread-safe; use one per thread.
+    const Transaction& add(const Transaction& tx);
+
+    // Applies the staged rows with one index update and one write, then
+    // notifies observers row by row. Throws without changing anything if a
+    // staged id was taken by a row added since it was staged, or if the
+    // rows cannot be written to storage; the rows stay staged. Returns the
+    // number of rows added; the batch is empty afterwards.
+    size_t commit();
+
+    void reserve(size_t rows);
+    size_t size() const { return rows.size(); }
+    bool empty() const { return rows.empty(); }
+};
+
+// Approximate resident size of the ledger by part, as counted by
+// TransactionRepository::memoryUsage(). Allocator headers are not included.
+struct MemoryUsage {
+    size_t rows = 0;            // slots, tombstones included
+    size_t tombstones = 0;      // removed rows not yet compacted away
+    size_t chunkBytes = 0;      // columns, records and date order of every chunk
+    size_t textBytes = 0;       // arena blocks holding ids and long notes
+    size_t textAbandoned = 0;   // arena bytes of superseded notes, included in textBytes
+    size_t indexBytes = 0;      // id, category and note indexes
+
+    size_t total() const { return chunkBytes + textBytes + indexBytes; }
+    double bytesPerRow() const { return rows > 0 ? static_cast<double>(total()) / rows : 0.0; }
+};
+
+// When TransactionRepository drops removed rows. A tombstone is kept for
+// retention seconds after its removal; once the tombstones past that make
+// up deadRatio of all slots, and number at least minReclaimable, the next
+// removal compacts the ledger.
+struct CompactionPolicy {
+    time_t retention = 7 * 24 * 60 * 60;
+    double deadRatio = 0.25;
+    size_t minReclaimable = 1024;
+};
+
+enum class PersistenceMode {
+    SNAPSHOT,   // rewrite the whole ledger on every mutation; a failed rewrite
+                // is reported and the next one carries the change
+    WAL         // append one log record per mutation, checkpoint periodically
+};
+
+// The ledger, safe to share between threads.
+//
+// Writes are serialized and each one publishes a new TransactionView.
+// Readers never wait for a write to finish: snapshot() hands out the latest
+// view, and every read below runs against one, so a scan sees a single
+// consistent version even while writers carry on. Index lookups hold a
+// shared lock only while planning; rows are visited after it is released.
+class TransactionRepository {
+private:
+    friend class TransactionBatch;
+
+    std::shared_ptr<IStorage> storage;
+
+    // Lock order: writeMutex, then indexMutex, then viewMutex
+    mutable std::mutex writeMutex;          // one writer at a time
+    mutable std::shared_mutex indexMutex;   // the indexes, and their agreement with current
+    mutable std::mutex viewMutex;           // current
+    std::shared_ptr<const TransactionView> current;
+
+    // Every categoryId stored, interned to the code kept in the rows and
+    // columns, plus the Category definitions
+    std::shared_ptr<CategoryRegistry> categoryRegistry;
+
+    // Text of the stored rows: every id and every note too long to keep
+    // inline in its record. Shared with the published views.
+    std::shared_ptr<TextArena> textArena;
+    size_t textAbandoned;                   // arena bytes of notes since replaced
+
+    // Writer state, guarded by writeMutex. segments are shared with the
+    // published views and copied before they change.
+    std::shared_ptr<TransactionView::Directory> segments;
+    bool directoryPublished;
+    size_t rowCount;
+    size_t liveCount;
+    uint64_t version;
+    size_t publishedRows;                   // rows covered by current
+    std::atomic<bool> columnarEnabled;
+    std::atomic<uint64_t> idCounter;
+
+    std::unordered_map<std::string_view, size_t> idIndex;   // arena id -> slot of its latest row
+
+    CompactionPolicy compactionPolicy;
+    std::vector<time_t> tombstoneTimes;     // removal times of the stored tombstones, sorted
+
+    // Secondary indexes over live rows; find() picks the most selective one
+    // and filters the candidates with the full predicate. Date ranges are
+    // served by the sealed chunks' date order.
+    std::vector<std::vector<size_t>> categoryIndex;   // category code -> sorted slots
+    NoteIndex noteIndex;
+
+    std::vector<std::pair<size_t, TransactionObserver>> observers;
+    size_t nextSubscription;
+
+    PersistenceMode persistenceMode;
+    uint64_t generation;          // generation of the current snapshot
+    size_t logBytes;              // bytes appended to the log since the last checkpoint
+    bool logBroken;               // an append failed, maybe leaving a torn record; nothing
+                                  // more is appended until a checkpoint replaces the log
+    size_t snapshotBytes;         // size of the last snapshot written or loaded
+    size_t checkpointMinBytes;    // never checkpoint before the log reaches this size
+
+public:
+    // Throws if the stored snapshot or log cannot be read, leaving the files
+    // untouched for recovery
+    explicit TransactionRepository(std::shared_ptr<IStorage> _storage,
+                                   PersistenceMode mode = PersistenceMode::WAL);
+    ~TransactionRepository();
+
+    Transaction add(const Transaction& tx);
+    Transaction update(const Transaction& tx);
+    void remove(const std::string& txId);
+
+    // find and the filtered forEach test each candidate's columns and stored
+    // note first and rebuild only the rows that match. getAll and the plain
+    // forEach rebuild every live row; scans that need no text are cheaper
+    // through snapshot() with RowFields::NUMERIC.
+    std::vector<Transaction> find(const TransactionFilter& filter) const;
+    Transaction getById(const std::string& id) const;
+    std::vector<Transaction> getAll() const;
+    void forEach(const TransactionVisitor& visitor) const;
+    void forEach(const TransactionFilter& filter, const TransactionVisitor& visitor) const;
+    size_t count() const;
+
+    // The latest published version of the ledger
+    std::shared_ptr<const TransactionView> snapshot() const;
+
+    // Bulk inserts: either all rows are added or, if any is rejected as
+    // add() would reject it, none are
+    std::vector<Transaction> addMany(const std::vector<Transaction>& txs);
+    TransactionBatch beginBatch();
+
+    // TransactionView::sumAmounts and sumByCategory over the latest view
+    ColumnSum sumAmounts(time_t from, time_t to, TransactionType type,
+                         ThreadPool* pool = nullptr) const;
+    std::map<std::string, ColumnSum> sumByCategory(time_t from, time_t to, TransactionType type,
+                                                   ThreadPool* pool = nullptr) const;
+
+    // The category dictionary. define() persists the definitions alongside
+    // the ledger; the ids themselves are stored with every snapshot.
+    const CategoryRegistry& categories() const { return *categoryRegistry; }
+    void defineCategory(const Category& category);
+    std::vector<Category> getCategories() const;
+
+    // The columns are always kept; disabling the store makes the aggregate
+    // scans use a plain row loop instead of the kernels
+    void setColumnarStoreEnabled(bool enabled);
+    bool isColumnarStoreEnabled() const { return columnarEnabled; }
+
+    // What the ledger occupies in memory, part by part
+    MemoryUsage memoryUsage() const;
+
+    // Observers see mutations made through add/update/remove; rows loaded
+    // from storage are not replayed to them
+    size_t subscribe(TransactionObserver observer);
+    void unsubscribe(size_t subscription);
+
+    // Folds the write-ahead log into a fresh snapshot and truncates the log,
+    // then waits for the storage to flush. Runs automatically, without the
+    // wait, once the log grows past the snapshot size. Throws if the
+    // snapshot could not be written; the log is then kept.
+    void checkpoint();
+    void setCheckpointMinBytes(size_t bytes);
+
+    // Drops the tombstones removed longer than the retention window ago,
+    // from memory and from storage, and moves the remaining text to a fresh
+    // arena. Live rows keep their order and version() is unchanged, but
+    // slots are renumbered. Readers keep their views and wait only for the
+    // swap; writers wait for the whole pass. Returns the rows dropped.
+    // Throws if the snapshot could not be written, as checkpoint() does;
+    // storage then keeps the dropped tombstones until the next checkpoint.
+    size_t compact();
+    void setCompactionPolicy(const CompactionPolicy& policy);
+    CompactionPolicy getCompactionPolicy() const;
+
+private:
+    void loadFromStorage();
+    void loadCategories();
+    void saveCategories();
+    void loadSnapshot(std::shared_ptr<const MappedFile> mapped);
+    void loadLegacySnapshot();
+    void replayLog();
+    bool saveToStorage();
+    void logMutation(LogOp op, const Transaction& tx);
+    void appendToLog(const std::string& records);
+    void checkpointIfDue();
+    void persistBatch(size_t firstSlot, const std::vector<Transaction>& rows);
+    bool writeCheckpoint();
+    void compactIfDue();
+    size_t compactTombstones(time_t cutoff);
+    size_t commitBatch(std::vector<Transaction>& rows);
+    void applyLogRecord(const LogRecord& record);
+
+    // Slot of the latest row carrying id, or SIZE_MAX. The caller holds
+    // writeMutex or indexMutex.
+    size_t findSlot(const std::string& id) const;
+
+    // Writer-side row access and storage; see TransactionChunk for when a
+    // chunk is written in place and when it is copied
+    const TransactionChunk& chunkFor(size_t slot) const;
+    bool isDeleted(size_t slot) const;
+    Transaction row(size_t slot) const;
+    void storeRow(size_t slot, const Transaction& tx);
+    void publish();
+
+    void rebuildIndexes();
+    void notifyObservers(const Transaction* before, const Transaction& after, uint64_t atVersion);
+    void addToSecondaryIndexes(size_t slot);
+    void removeFromSecondaryIndexes(size_t slot);
+    void appendRow(const Transaction& tx);
+    void replaceRow(size_t slot, const Transaction& tx);
+    std::string generateId();
+};
+
+#endif // TRANSACTIONREPOSITORY_H
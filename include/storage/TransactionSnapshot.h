@@ -0,0 +1,109 @@
+#ifndef TRANSACTIONSNAPSHOT_H
+#define TRANSACTIONSNAPSHOT_H
+
+#include "../models/Transaction.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Versioned binary columnar snapshot of the transaction ledger.
+//
+// Layout (little-endian, every section 8-byte aligned):
+//   header      magic "TXSNAP\0\0", version, header CRC32, generation,
+//               row count, heap size, category count and the offset of
+//               each section
+//   columns     amount i64[n] in Money minor units, date i64[n], createdAt i64[n], updatedAt i64[n],
+//               type u8[n], isDeleted u8[n], id as {u32 offset, u32 length}[n],
+//               category code u32[n], note as {u32 offset, u32 length}[n]
+//   categories  the category dictionary, code -> id, as {u32 offset, u32 length}[k]
+//   heap        string bytes referenced by the string columns and the dictionary
+//
+// Earlier versions are still read: version 2 stored amounts as f64, and
+// version 1 also stored each row's categoryId as a string in place of the
+// code column and had no dictionary.
+//
+// A snapshot opened over a memory-mapped file is queryable in place: the
+// column accessors read straight from the mapping, nothing is parsed per row.
+class TransactionSnapshot {
+public:
+    static const uint32_t VERSION = 3;
+
+    enum Column {
+        AMOUNT,
+        DATE,
+        CREATED_AT,
+        UPDATED_AT,
+        TYPE,
+        IS_DELETED,
+        ID,
+        CATEGORY_CODE,   // a string column in version 1
+        NOTE,
+        CATEGORIES,      // absent in version 1
+        HEAP,
+        COLUMN_COUNT
+    };
+
+    struct StringRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    // Returns true if the bytes start with the snapshot magic
+    static bool isSnapshot(const MappedFile& file);
+
+    // Validates the header and section bounds; throws std::runtime_error
+    // on a truncated, corrupted or unsupported snapshot
+    explicit TransactionSnapshot(std::shared_ptr<const MappedFile> file);
+
+    // Encodes rowCount rows, load(i, tx) filling tx with the i-th. Each
+    // row's categoryCode indexes categoryIds, which is stored as the
+    // dictionary.
+    static std::string encode(size_t rowCount,
+                              const std::function<void(size_t, Transaction&)>& load,
+                              const std::vector<std::string>& categoryIds, uint64_t generation);
+
+    uint64_t generation() const { return snapshotGeneration; }
+    size_t size() const { return rowCount; }
+
+    // The category dictionary. A version 1 snapshot has none and reports
+    // UINT32_MAX as every row's code.
+    size_t categoryCount() const { return categories; }
+    std::string_view category(uint32_t code) const;
+    uint32_t categoryCode(size_t row) const;
+
+    const int64_t* dates() const { return reinterpret_cast<const int64_t*>(section(DATE)); }
+    const uint8_t* types() const { return reinterpret_cast<const uint8_t*>(section(TYPE)); }
+    const uint8_t* deletedFlags() const { return reinterpret_cast<const uint8_t*>(section(IS_DELETED)); }
+
+    Money amount(size_t row) const;
+    TransactionType type(size_t row) const;
+    time_t date(size_t row) const { return static_cast<time_t>(dates()[row]); }
+    time_t createdAt(size_t row) const;
+    time_t updatedAt(size_t row) const;
+    bool isDeleted(size_t row) const { return deletedFlags()[row] != 0; }
+    std::string_view id(size_t row) const { return string(ID, row); }
+    std::string_view categoryId(size_t row) const;
+    std::string_view note(size_t row) const { return string(NOTE, row); }
+
+    // categoryCode is left unassigned: snapshot codes are local to the file
+    Transaction row(size_t row) const;
+
+private:
+    std::shared_ptr<const MappedFile> file;
+    uint64_t snapshotGeneration;
+    size_t rowCount;
+    uint64_t heapSize;
+    size_t categories;
+    uint32_t formatVersion;
+    uint64_t offsets[COLUMN_COUNT];
+
+    const char* section(Column column) const { return file->data() + offsets[column]; }
+    std::string_view string(Column column, size_t row) const;
+    std::string_view heapString(StringRef ref) const;
+};
+
+#endif // TRANSACTIONSNAPSHOT_H
@@ -0,0 +1,219 @@
+#ifndef TRANSACTIONVIEW_H
+#define TRANSACTIONVIEW_H
+
+#include "../models/Transaction.h"
+#include "TextArena.h"
+#include "TransactionColumns.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+// Receives live rows in storage order. The reference is only valid for the
+// duration of the call; copy the row if it must outlive it.
+using TransactionVisitor = std::function<void(const Transaction&)>;
+
+// What a scan rebuilds of each row it visits. Rows are stored compactly and
+// rebuilt into a Transaction one at a time; scans that only aggregate ask
+// for NUMERIC, which skips copying the id, categoryId and note and leaves
+// them empty.
+enum class RowFields {
+    ALL,
+    NUMERIC
+};
+
+// A row filter checked against a row's columns and stored note before the
+// row is rebuilt, so rows it rejects cost no copies. Unset members accept
+// every row; dates of 0 or less leave that end of the range open.
+struct RowConditions {
+    uint32_t categoryCode = UINT32_MAX;
+    const TransactionType* type = nullptr;
+    time_t dateFrom = 0;
+    time_t dateTo = 0;
+    const std::vector<std::string>* noteTerms = nullptr;   // each must occur in the note
+};
+
+// The part of a stored row that its chunk's columns do not hold: amount,
+// date, type, category and the deleted flag live only in the columns, and
+// a Transaction is rebuilt from the two when it is read. 40 bytes, against
+// the 150-odd of a Transaction plus the allocations of its strings.
+//
+// Timestamps are seconds from TIME_BASE, which 32 bits cover from 1951 to
+// 2088; a row with a time outside that keeps both in its chunk's wideTimes.
+struct TransactionRecord {
+    static constexpr int64_t TIME_BASE = 1577836800;   // 2020-01-01T00:00:00Z
+    static constexpr int32_t WIDE = INT32_MIN;          // the times are in wideTimes
+
+    CompactText id;     // always external, so the id index can key on the arena text
+    CompactText note;
+    int32_t createdAt;
+    int32_t updatedAt;
+};
+
+// Timestamps of a row that do not fit its TransactionRecord
+struct WideTimes {
+    uint16_t slot;
+    int64_t createdAt;
+    int64_t updatedAt;
+};
+
+// ROWS consecutive slots of the ledger: their columns and records. A full
+// chunk is sealed: its slots are ordered by date and its date bounds
+// recorded, so date-range queries binary-search it instead of scanning.
+//
+// Chunks are shared by every view that covers them. No view reads a slot at
+// or past its own row count, so the writer fills the tail chunk in place;
+// any other change is made to a copy. Record text points into the ledger's
+// TextArena, which every view holds on to.
+struct TransactionChunk {
+    static constexpr size_t ROWS = 256;
+
+    TransactionColumns columns;
+    std::array<TransactionRecord, ROWS> records;
+    std::vector<WideTimes> wideTimes;    // by slot; almost always empty
+    std::array<uint16_t, ROWS> byDate;   // slots ordered by (date, slot); sealed chunks only
+    int64_t minDate;
+    int64_t maxDate;
+
+    TransactionChunk() : columns(ROWS), records(), byDate(), minDate(0), maxDate(0) {}
+
+    // Stores tx in slot, with id and note already placed in the arena (or
+    // inline) by the caller
+    void store(size_t slot, const Transaction& tx, uint32_t categoryCode, CompactText id,
+               CompactText note);
+
+    std::string_view id(size_t slot) const { return records[slot].id.view(); }
+    std::string_view note(size_t slot) const { return records[slot].note.view(); }
+    time_t createdAt(size_t slot) const;
+    time_t updatedAt(size_t slot) const;
+
+    // Rebuilds the row in slot into out, reusing its strings' capacity.
+    // categoryId is the id of the slot's category code.
+    void load(size_t slot, const std::string& categoryId, Transaction& out) const;
+
+    // Everything but the id, categoryId and note, which are left as they were
+    void loadNumeric(size_t slot, Transaction& out) const;
+
+    // Bytes of the chunk, its columns and its wideTimes
+    size_t memoryBytes() const;
+
+    // Orders a full chunk by date and records its bounds
+    void seal();
+
+    // Moves one slot of a sealed chunk to its place after its date changed
+    void reseal(size_t slot);
+};
+
+// CHUNKS consecutive chunks. Views share segments the way they share
+// chunks: replacing a chunk copies its segment and the short segment list,
+// not a pointer per chunk of the ledger. Slots past the end of the ledger
+// are empty and filled in place as it grows.
+struct TransactionSegment {
+    static constexpr size_t CHUNKS = 32;
+
+    std::array<std::shared_ptr<TransactionChunk>, CHUNKS> chunks;
+};
+
+// The ledger as of one version, as published by TransactionRepository.
+//
+// A view never changes: everything read through it reflects the same
+// version however many writes follow, and reading it takes no locks. Long
+// scans such as reports and exports run against a view while writers carry
+// on. Holding a view keeps the chunks it covers alive; superseded chunks are
+// freed when the last view referencing them is released.
+class TransactionView {
+public:
+    using Directory = std::vector<std::shared_ptr<TransactionSegment>>;
+
+    // Slots are split into fixed blocks of PARTITION_ROWS for parallel
+    // scans. The split does not depend on the thread count, so partials
+    // merged in partition order come out the same however many threads ran.
+    static constexpr size_t PARTITION_ROWS = 1 << 16;
+
+    TransactionView(std::shared_ptr<const Directory> segments,
+                    std::shared_ptr<const std::vector<std::string>> categoryIds,
+                    std::shared_ptr<const TextArena> text, size_t rowCount, size_t liveCount,
+                    uint64_t version, bool columnar);
+
+    // Number of row changes (adds, updates and removals) this view includes
+    uint64_t version() const { return versionNumber; }
+
+    size_t size() const { return rowCount; }   // slots, tombstones included
+    size_t liveCount() const { return live; }
+    Transaction at(size_t slot) const;
+    bool isDeleted(size_t slot) const;
+
+    // at(), rebuilding the row into out and reusing its strings' capacity
+    void load(size_t slot, Transaction& out) const;
+
+    void forEach(const TransactionVisitor& visitor, RowFields fields = RowFields::ALL) const;
+    size_t partitionCount() const;
+    void forEachInPartition(size_t partition, const TransactionVisitor& visitor,
+                            RowFields fields = RowFields::ALL) const;
+
+    // Live rows dated within [from, to] (0 = open end), in storage order
+    void forEachInDateRange(time_t from, time_t to, const TransactionVisitor& visitor,
+                            RowFields fields = RowFields::ALL) const;
+
+    // Whether the row in slot is live and satisfies conditions, judged
+    // without rebuilding it
+    bool satisfies(size_t slot, const RowConditions& conditions) const;
+
+    // forEach, and forEachInDateRange over the conditions' dates, visiting
+    // only the rows that satisfy conditions; no other row is rebuilt
+    void forEach(const RowConditions& conditions, const TransactionVisitor& visitor) const;
+    void forEachInDateRange(const RowConditions& conditions, const TransactionVisitor& visitor) const;
+
+    // Slots dated within [from, to], tombstones included; counting stops
+    // once it reaches limit
+    size_t countInDateRange(time_t from, time_t to, size_t limit = SIZE_MAX) const;
+
+    // Category codes this view's rows may carry, and the id of each
+    size_t categoryCount() const { return categoryIds->size(); }
+    const std::string& categoryId(uint32_t code) const { return (*categoryIds)[code]; }
+
+    // Sum of live rows of one type dated within [from, to] (0 = open end),
+    // overall or per category, one partition per task on the pool (or
+    // inline when it is null). Each chunk either walks its date order, when
+    // few of its rows can match, or runs the columnar kernel over all of
+    // them (a plain row loop when the columnar store is disabled).
+    ColumnSum sumAmounts(time_t from, time_t to, TransactionType type,
+                         ThreadPool* pool = nullptr) const;
+
+    // Indexed by category code, categoryCount() entries
+    std::vector<ColumnSum> sumByCategoryCode(time_t from, time_t to, TransactionType type,
+                                             ThreadPool* pool = nullptr) const;
+
+    // Keyed by categoryId, categories without matching rows left out
+    std::map<std::string, ColumnSum> sumByCategory(time_t from, time_t to, TransactionType type,
+                                                   ThreadPool* pool = nullptr) const;
+
+    bool isColumnar() const { return columnar; }
+
+private:
+    std::shared_ptr<const Directory> segments;
+    std::shared_ptr<const std::vector<std::string>> categoryIds;   // code -> categoryId
+    std::shared_ptr<const TextArena> text;                         // what the records point into
+    size_t rowCount;
+    size_t live;
+    uint64_t versionNumber;
+    bool columnar;
+
+    // Rows of the given chunk that this view covers; a chunk covered in
+    // full is sealed
+    size_t rowsIn(size_t chunk) const;
+    size_t chunkCount() const;
+    void scanDateRange(time_t from, time_t to, const RowConditions* conditions, RowFields fields,
+                       const TransactionVisitor& visitor) const;
+    const TransactionChunk& chunkAt(size_t chunk) const {
+        return *(*segments)[chunk / TransactionSegment::CHUNKS]->chunks[chunk % TransactionSegment::CHUNKS];
+    }
+};
+
+#endif // TRANSACTIONVIEW_H
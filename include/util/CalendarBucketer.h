@@ -0,0 +1,58 @@
+#ifndef CALENDARBUCKETER_H
+#define CALENDARBUCKETER_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+enum class Granularity {
+    DAY,
+    WEEK,       // ISO weeks, starting on Monday
+    MONTH,
+    QUARTER,
+    YEAR
+};
+
+// Maps timestamps to integer calendar buckets in the local time zone.
+//
+// The zone's UTC offsets are sampled once at construction into a table of
+// transitions, so bucketing is a binary search plus civil-date arithmetic:
+// no localtime, no global lock, safe to call from any thread. Bucket ids are
+// ordered like time and labels are only formatted on demand. Outside
+// 1902-2100 the nearest sampled offset is assumed.
+//
+// Month ids are year * 12 + (month - 1), quarter ids year * 4 + (quarter - 1)
+// and year ids the year itself, so coarser ids follow from month ids by
+// floor division. Day and week ids count from 1970-01-01 and the week
+// containing it.
+class CalendarBucketer {
+private:
+    std::vector<int64_t> segmentStarts;   // UTC start of each constant-offset segment
+    std::vector<int32_t> segmentOffsets;  // seconds east of UTC within it
+
+public:
+    // Captures the current TZ; later changes to it are not picked up
+    CalendarBucketer();
+
+    int64_t bucket(time_t timestamp, Granularity granularity) const;
+
+    // First instant of the bucket: local midnight of its first day, or the
+    // end of the gap when a DST jump skips that midnight
+    time_t bucketStart(int64_t bucket, Granularity granularity) const;
+
+    // "2024-03-05", "2024-W10", "2024-03", "2024-Q1", "2024"
+    std::string label(int64_t bucket, Granularity granularity) const;
+
+    // Coarsens a month id to a MONTH, QUARTER or YEAR id
+    static int64_t fromMonth(int64_t month, Granularity granularity);
+
+    int32_t utcOffset(time_t timestamp) const;
+
+private:
+    int64_t localDay(time_t timestamp) const;
+    time_t firstInstantAtOrAfter(int64_t localSeconds) const;
+    size_t segmentOf(int64_t timestamp) const;
+};
+
+#endif // CALENDARBUCKETER_H
@@ -0,0 +1,62 @@
+#ifndef LRUCACHE_H
+#define LRUCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+struct CacheStats {
+    size_t entries = 0;
+    size_t bytes = 0;       // keys, values and bookkeeping of the entries held
+    size_t budget = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+// String values by key, dropping the least recently used once their size
+// passes a byte budget. A hash table over a recency list makes lookups,
+// inserts and evictions O(1). A value that alone exceeds the budget is not
+// kept. Not thread-safe; the owner serializes calls.
+class LruCache {
+private:
+    using Entry = std::pair<std::string, std::string>;
+
+    std::list<Entry> entries;   // most recently used first
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;   // keys view entries
+    size_t budget;
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+
+public:
+    explicit LruCache(size_t budgetBytes);
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    // The cached value, marked most recently used, or nullptr. Counts a
+    // hit or a miss. The pointer is valid until the cache next changes.
+    const std::string* find(const std::string& key);
+
+    void put(const std::string& key, std::string value);
+
+    // Extends a cached value in place and marks it most recently used; does
+    // nothing if key is not cached
+    void append(const std::string& key, const std::string& suffix);
+
+    void erase(const std::string& key);
+    void setBudget(size_t budgetBytes);
+    CacheStats stats() const;
+
+private:
+    static size_t cost(const std::string& key, const std::string& value);
+    void evict();
+};
+
+#endif // LRUCACHE_H
@@ -0,0 +1,65 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool for data-parallel loops. parallelFor() hands out task
+// indices to the workers and the calling thread alike and returns once every
+// index has run, so a pool of N threads starts N - 1 workers.
+//
+// Callers that need results independent of the thread count should give
+// each index its own partial result and merge the partials in index order.
+class ThreadPool {
+private:
+    struct Job {
+        const std::function<void(size_t)>* task;
+        size_t count;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> completed{0};
+        std::mutex errorMutex;
+        std::exception_ptr error;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::shared_ptr<Job> job;     // job being handed out, null when idle
+    bool stopping;
+
+    std::mutex runMutex;          // one parallelFor at a time
+
+public:
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads taking part in parallelFor, the caller included
+    size_t size() const { return workers.size() + 1; }
+
+    // Runs task(0) .. task(count - 1) and waits for all of them. The first
+    // exception thrown by a task is rethrown here once the rest have run.
+    // Not reentrant: tasks must not call parallelFor on the same pool.
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+    // parallelFor on the pool, or a plain loop on the caller when it is null
+    static void run(ThreadPool* pool, size_t count, const std::function<void(size_t)>& task);
+
+    static size_t hardwareThreads();
+
+private:
+    void workerLoop();
+    void drain(Job& current);
+};
+
+#endif // THREADPOOL_H
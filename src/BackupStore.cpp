@@ -0,0 +1,436 @@
+#include "../include/storage/BackupStore.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const MANIFEST_HEADER = "#backup|1";
+const char* const MANIFEST_EXTENSION = ".manifest";
+
+// Content-defined chunking: a boundary falls after any byte where the gear
+// hash of the preceding 64 bytes has its low 16 bits clear, which gives
+// chunks of about 80 KiB between the two limits
+const size_t MIN_CHUNK = 16 * 1024;
+const size_t MAX_CHUNK = 256 * 1024;
+const uint64_t BOUNDARY_MASK = 0xFFFF;
+
+uint64_t splitmix(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+const std::array<uint64_t, 256>& gearTable() {
+    static const std::array<uint64_t, 256> table = [] {
+        std::array<uint64_t, 256> values{};
+        uint64_t state = 0;
+        for (auto& value : values) {
+            value = splitmix(state);
+        }
+        return values;
+    }();
+    return table;
+}
+
+// Length of the chunk starting at data
+size_t nextBoundary(const unsigned char* data, size_t size) {
+    if (size <= MIN_CHUNK) {
+        return size;
+    }
+    const auto& gear = gearTable();
+    size_t limit = std::min(size, MAX_CHUNK);
+    uint64_t hash = 0;
+    // Start a window early so the first candidate sees a full 64 bytes
+    for (size_t i = MIN_CHUNK - 64; i < limit; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+        if (i >= MIN_CHUNK && (hash & BOUNDARY_MASK) == 0) {
+            return i + 1;
+        }
+    }
+    return limit;
+}
+
+uint64_t fmix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+uint64_t rotl(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+// 128-bit hash of a chunk as 32 hex digits; two lanes in the manner of
+// MurmurHash3's x64 variant
+std::string hashChunk(const unsigned char* data, size_t size) {
+    uint64_t h1 = 0x243F6A8885A308D3ULL;
+    uint64_t h2 = 0x13198A2E03707344ULL;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint64_t k1;
+        uint64_t k2;
+        std::memcpy(&k1, data + i, sizeof(k1));
+        std::memcpy(&k2, data + i + 8, sizeof(k2));
+        h1 ^= fmix(k1);
+        h1 = rotl(h1, 27) + h2;
+        h1 = h1 * 5 + 0x52DCE729;
+        h2 ^= fmix(k2 ^ 0x9E3779B97F4A7C15ULL);
+        h2 = rotl(h2, 31) + h1;
+        h2 = h2 * 5 + 0x38495AB5;
+    }
+    unsigned char tail[16] = {};
+    std::memcpy(tail, data + i, size - i);
+    uint64_t k1;
+    uint64_t k2;
+    std::memcpy(&k1, tail, sizeof(k1));
+    std::memcpy(&k2, tail + 8, sizeof(k2));
+    h1 ^= fmix(k1 ^ size);
+    h2 ^= fmix(k2 ^ (size - i));
+
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+
+    char hex[33];
+    std::snprintf(hex, sizeof(hex), "%016llx%016llx", static_cast<unsigned long long>(h1),
+                  static_cast<unsigned long long>(h2));
+    return std::string(hex, 32);
+}
+
+// Sleeps as needed to keep the bytes passed to consume() under a rate
+class RateLimiter {
+private:
+    uint64_t bytesPerSecond;
+    uint64_t bytes;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit RateLimiter(uint64_t rate)
+        : bytesPerSecond(rate), bytes(0), start(std::chrono::steady_clock::now()) {}
+
+    void consume(uint64_t count) {
+        if (bytesPerSecond == 0) return;
+        bytes += count;
+        auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                               std::chrono::duration<double>(static_cast<double>(bytes) / bytesPerSecond));
+        if (due > std::chrono::steady_clock::now()) {
+            std::this_thread::sleep_until(due);
+        }
+    }
+};
+
+void writeAtomically(const std::string& path, const char* data, size_t size) {
+    std::string tempPath = path + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + tempPath);
+    }
+    file.write(data, static_cast<std::streamsize>(size));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write file: " + tempPath);
+    }
+    fs::rename(tempPath, path);
+}
+
+struct ManifestChunk {
+    std::string hash;
+    size_t size;
+};
+
+struct ManifestFile {
+    std::string name;
+    uint64_t size = 0;
+    int64_t modified = 0;
+    std::vector<ManifestChunk> chunks;
+};
+
+// A manifest is a header line, then per file a
+// "file|<size>|<modified>|<name>" line and one "chunk|<hash>|<size>" line
+// per chunk, in order
+std::vector<ManifestFile> readManifest(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Backup not found: " + path);
+    }
+    std::string line;
+    if (!std::getline(file, line) || line != MANIFEST_HEADER) {
+        throw std::runtime_error("Not a backup manifest: " + path);
+    }
+
+    std::vector<ManifestFile> files;
+    while (std::getline(file, line)) {
+        if (line.compare(0, 5, "file|") == 0) {
+            size_t sizeEnd = line.find('|', 5);
+            size_t modifiedEnd = sizeEnd == std::string::npos ? sizeEnd : line.find('|', sizeEnd + 1);
+            if (modifiedEnd == std::string::npos) {
+                throw std::runtime_error("Malformed backup manifest: " + path);
+            }
+            ManifestFile entry;
+            entry.size = std::stoull(line.substr(5, sizeEnd - 5));
+            entry.modified = std::stoll(line.substr(sizeEnd + 1, modifiedEnd - sizeEnd - 1));
+            entry.name = line.substr(modifiedEnd + 1);
+            files.push_back(std::move(entry));
+        } else if (line.compare(0, 6, "chunk|") == 0 && !files.empty()) {
+            size_t hashEnd = line.find('|', 6);
+            if (hashEnd == std::string::npos) {
+                throw std::runtime_error("Malformed backup manifest: " + path);
+            }
+            files.back().chunks.push_back({line.substr(6, hashEnd - 6),
+                                           static_cast<size_t>(std::stoull(line.substr(hashEnd + 1)))});
+        } else if (!line.empty()) {
+            throw std::runtime_error("Malformed backup manifest: " + path);
+        }
+    }
+    return files;
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() &&
+           text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Orders generation names, <timestamp>-<sequence>, by time and then by
+// sequence as a number: past 999 the sequence outgrows its zero padding,
+// and "-1000" would otherwise sort before "-999"
+bool generationBefore(const std::string& a, const std::string& b) {
+    size_t dashA = a.rfind('-');
+    size_t dashB = b.rfind('-');
+    int byTime = a.compare(0, dashA, b, 0, dashB);
+    if (byTime != 0) {
+        return byTime < 0;
+    }
+    std::string_view sequenceA = std::string_view(a).substr(dashA + 1);
+    std::string_view sequenceB = std::string_view(b).substr(dashB + 1);
+    sequenceA.remove_prefix(std::min(sequenceA.find_first_not_of('0'), sequenceA.size()));
+    sequenceB.remove_prefix(std::min(sequenceB.find_first_not_of('0'), sequenceB.size()));
+    if (sequenceA.size() != sequenceB.size()) {
+        return sequenceA.size() < sequenceB.size();
+    }
+    return sequenceA < sequenceB;
+}
+
+} // namespace
+
+BackupStore::BackupStore(const std::string& _root, size_t _retention)
+    : root(_root), retention(std::max<size_t>(_retention, 1)), bytesPerSecond(0) {}
+
+std::vector<BackupSource> BackupStore::capture(const std::string& dir) {
+    std::vector<BackupSource> sources;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        std::string name = entry.path().filename().string();
+        if (!entry.is_regular_file() || endsWith(name, ".tmp")) {
+            continue;
+        }
+        BackupSource source;
+        source.name = name;
+        source.modified = static_cast<int64_t>(entry.last_write_time().time_since_epoch().count());
+        source.content = MappedFile::open(entry.path().string());
+        if (!source.content) {
+            continue;
+        }
+        source.size = source.content->size();
+        sources.push_back(std::move(source));
+    }
+    std::sort(sources.begin(), sources.end(),
+              [](const BackupSource& a, const BackupSource& b) { return a.name < b.name; });
+    return sources;
+}
+
+std::string BackupStore::write(const std::vector<BackupSource>& sources) {
+    std::lock_guard<std::mutex> lock(mutex);
+    fs::create_directories(root + "/manifests");
+    fs::create_directories(root + "/chunks");
+
+    // Files unchanged since the previous generation keep its chunk lists
+    std::vector<std::string> names = generations();
+    std::vector<ManifestFile> previous;
+    if (!names.empty()) {
+        previous = readManifest(manifestPath(names.back()));
+    }
+
+    // Names sort by time; backups within one second, or after the clock
+    // went back, continue the latest name's sequence
+    char stamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::gmtime(&now));
+    std::string base = stamp;
+    unsigned sequence = 0;
+    if (!names.empty()) {
+        const std::string& latest = names.back();
+        size_t dash = latest.rfind('-');
+        if (latest.substr(0, dash) >= base) {
+            base = latest.substr(0, dash);
+            sequence = static_cast<unsigned>(std::stoul(latest.substr(dash + 1))) + 1;
+        }
+    }
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), "-%03u", sequence);
+
+    BackupStats stats;
+    stats.generation = base + suffix;
+    RateLimiter limiter(bytesPerSecond);
+    std::ostringstream manifest;
+    manifest << MANIFEST_HEADER << "\n";
+
+    for (const auto& source : sources) {
+        ++stats.files;
+        manifest << "file|" << source.size << "|" << source.modified << "|" << source.name << "\n";
+
+        auto before = std::find_if(previous.begin(), previous.end(),
+                                   [&](const ManifestFile& file) { return file.name == source.name; });
+        if (before != previous.end() && before->size == source.size &&
+            before->modified == source.modified) {
+            ++stats.filesUnchanged;
+            for (const auto& chunk : before->chunks) {
+                manifest << "chunk|" << chunk.hash << "|" << chunk.size << "\n";
+            }
+            stats.chunks += before->chunks.size();
+            continue;
+        }
+
+        const auto* data = reinterpret_cast<const unsigned char*>(source.content->data());
+        size_t size = source.content->size();
+        for (size_t offset = 0; offset < size;) {
+            size_t length = nextBoundary(data + offset, size - offset);
+            limiter.consume(length);
+            stats.bytesRead += length;
+
+            std::string hash = hashChunk(data + offset, length);
+            std::string path = chunkPath(hash);
+            if (!fs::exists(path)) {
+                fs::create_directories(fs::path(path).parent_path());
+                writeAtomically(path, reinterpret_cast<const char*>(data + offset), length);
+                limiter.consume(length);
+                stats.bytesStored += length;
+                ++stats.chunksStored;
+            }
+            manifest << "chunk|" << hash << "|" << length << "\n";
+            ++stats.chunks;
+            offset += length;
+        }
+    }
+
+    // The manifest goes last: a backup interrupted before it leaves only
+    // unreferenced chunks, which the next prune removes
+    std::string path = manifestPath(stats.generation);
+    std::string content = manifest.str();
+    writeAtomically(path, content.data(), content.size());
+    last = stats;
+    prune();
+    return path;
+}
+
+std::vector<std::string> BackupStore::generations() const {
+    std::vector<std::string> names;
+    std::string dir = root + "/manifests";
+    if (!fs::is_directory(dir)) {
+        return names;
+    }
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && endsWith(name, MANIFEST_EXTENSION)) {
+            names.push_back(name.substr(0, name.size() - std::strlen(MANIFEST_EXTENSION)));
+        }
+    }
+    std::sort(names.begin(), names.end(), generationBefore);
+    return names;
+}
+
+void BackupStore::restore(const std::string& generation, const std::string& targetDir) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<ManifestFile> files = readManifest(manifestPath(generation));
+    fs::create_directories(targetDir);
+
+    for (const auto& file : files) {
+        std::string content;
+        content.reserve(file.size);
+        for (const auto& chunk : file.chunks) {
+            std::ifstream in(chunkPath(chunk.hash), std::ios::binary);
+            if (!in.is_open()) {
+                throw std::runtime_error("Backup chunk missing: " + chunk.hash);
+            }
+            std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            if (bytes.size() != chunk.size ||
+                hashChunk(reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size()) != chunk.hash) {
+                throw std::runtime_error("Backup chunk damaged: " + chunk.hash);
+            }
+            content += bytes;
+        }
+        if (content.size() != file.size) {
+            throw std::runtime_error("Backup of " + file.name + " is incomplete");
+        }
+        writeAtomically(targetDir + "/" + file.name, content.data(), content.size());
+    }
+}
+
+void BackupStore::setRetention(size_t generations) {
+    std::lock_guard<std::mutex> lock(mutex);
+    retention = std::max<size_t>(generations, 1);
+}
+
+void BackupStore::setRateLimit(uint64_t rate) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bytesPerSecond = rate;
+}
+
+BackupStats BackupStore::lastStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return last;
+}
+
+std::string BackupStore::manifestPath(const std::string& generation) const {
+    return root + "/manifests/" + generation + MANIFEST_EXTENSION;
+}
+
+std::string BackupStore::chunkPath(const std::string& hash) const {
+    // Two hex digits of fan-out keep directories small
+    return root + "/chunks/" + hash.substr(0, 2) + "/" + hash;
+}
+
+void BackupStore::prune() {
+    std::vector<std::string> names = generations();
+    size_t expired = names.size() > retention ? names.size() - retention : 0;
+    for (size_t i = 0; i < expired; ++i) {
+        fs::remove(manifestPath(names[i]));
+    }
+
+    // Chunks no remaining manifest mentions: those of the generations just
+    // dropped, and any left by an interrupted backup
+    std::unordered_set<std::string> referenced;
+    for (size_t i = expired; i < names.size(); ++i) {
+        for (const auto& file : readManifest(manifestPath(names[i]))) {
+            for (const auto& chunk : file.chunks) {
+                referenced.insert(chunk.hash);
+            }
+        }
+    }
+    std::vector<fs::path> unreferenced;
+    for (const auto& entry : fs::recursive_directory_iterator(root + "/chunks")) {
+        if (entry.is_regular_file() && referenced.count(entry.path().filename().string()) == 0) {
+            unreferenced.push_back(entry.path());
+        }
+    }
+    for (const auto& path : unreferenced) {
+        fs::remove(path);
+    }
+}
@@ -0,0 +1,185 @@
+#include "../include/util/CalendarBucketer.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+const int64_t SECONDS_PER_DAY = 86400;
+
+// Sampled range, as days since 1970-01-01: 1902-01-01 .. 2100-01-01
+const int64_t FIRST_SAMPLED_DAY = -24837;
+const int64_t LAST_SAMPLED_DAY = 47482;
+
+int64_t floorDiv(int64_t value, int64_t divisor) {
+    int64_t quotient = value / divisor;
+    return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+}
+
+// Proleptic Gregorian conversions after H. Hinnant's civil_from_days
+int64_t daysFromCivil(int64_t year, int month, int day) {
+    year -= month <= 2;
+    int64_t era = floorDiv(year, 400);
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+void civilFromDays(int64_t days, int64_t& year, int& month, int& day) {
+    days += 719468;
+    int64_t era = floorDiv(days, 146097);
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t shiftedMonth = (5 * dayOfYear + 2) / 153;
+    day = static_cast<int>(dayOfYear - (153 * shiftedMonth + 2) / 5 + 1);
+    month = static_cast<int>(shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9);
+    year = yearOfEra + era * 400 + (month <= 2);
+}
+
+int32_t sampleOffset(time_t timestamp) {
+    struct tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &timestamp);
+#else
+    localtime_r(&timestamp, &local);
+#endif
+    int64_t localSeconds = daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday) * SECONDS_PER_DAY +
+                           local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+    return static_cast<int32_t>(localSeconds - static_cast<int64_t>(timestamp));
+}
+
+} // namespace
+
+CalendarBucketer::CalendarBucketer() {
+    // Sample once a day and bisect to the second wherever the offset changed
+    time_t previous = static_cast<time_t>(FIRST_SAMPLED_DAY * SECONDS_PER_DAY);
+    int32_t previousOffset = sampleOffset(previous);
+    segmentStarts.push_back(INT64_MIN);
+    segmentOffsets.push_back(previousOffset);
+
+    for (int64_t day = FIRST_SAMPLED_DAY + 1; day <= LAST_SAMPLED_DAY; ++day) {
+        time_t current = static_cast<time_t>(day * SECONDS_PER_DAY);
+        int32_t offset = sampleOffset(current);
+        if (offset != previousOffset) {
+            time_t low = previous;
+            time_t high = current;
+            while (high - low > 1) {
+                time_t middle = low + (high - low) / 2;
+                (sampleOffset(middle) == previousOffset ? low : high) = middle;
+            }
+            segmentStarts.push_back(static_cast<int64_t>(high));
+            segmentOffsets.push_back(offset);
+            previousOffset = offset;
+        }
+        previous = current;
+    }
+}
+
+size_t CalendarBucketer::segmentOf(int64_t timestamp) const {
+    return static_cast<size_t>(std::upper_bound(segmentStarts.begin(), segmentStarts.end(), timestamp) -
+                               segmentStarts.begin()) - 1;
+}
+
+int32_t CalendarBucketer::utcOffset(time_t timestamp) const {
+    return segmentOffsets[segmentOf(static_cast<int64_t>(timestamp))];
+}
+
+int64_t CalendarBucketer::localDay(time_t timestamp) const {
+    return floorDiv(static_cast<int64_t>(timestamp) + utcOffset(timestamp), SECONDS_PER_DAY);
+}
+
+int64_t CalendarBucketer::bucket(time_t timestamp, Granularity granularity) const {
+    int64_t day = localDay(timestamp);
+    if (granularity == Granularity::DAY) {
+        return day;
+    }
+    if (granularity == Granularity::WEEK) {
+        return floorDiv(day + 3, 7);   // 1970-01-01 was a Thursday
+    }
+
+    int64_t year;
+    int month, dayOfMonth;
+    civilFromDays(day, year, month, dayOfMonth);
+    return fromMonth(year * 12 + month - 1, granularity);
+}
+
+int64_t CalendarBucketer::fromMonth(int64_t month, Granularity granularity) {
+    switch (granularity) {
+        case Granularity::QUARTER: return floorDiv(month, 3);
+        case Granularity::YEAR:    return floorDiv(month, 12);
+        default:                   return month;
+    }
+}
+
+time_t CalendarBucketer::firstInstantAtOrAfter(int64_t localSeconds) const {
+    // Offsets stay within a day of UTC, so scanning forward from two days
+    // earlier meets every segment that can contain the answer. Local time
+    // only runs backwards inside a fall-back overlap, where the earlier
+    // occurrence is the one wanted.
+    for (size_t segment = segmentOf(localSeconds - 2 * SECONDS_PER_DAY); segment < segmentStarts.size(); ++segment) {
+        int64_t offset = segmentOffsets[segment];
+        bool last = segment + 1 == segmentStarts.size();
+        if (last || segmentStarts[segment + 1] + offset > localSeconds) {
+            return static_cast<time_t>(std::max(segmentStarts[segment], localSeconds - offset));
+        }
+    }
+    return static_cast<time_t>(localSeconds);
+}
+
+time_t CalendarBucketer::bucketStart(int64_t bucket, Granularity granularity) const {
+    int64_t firstDay;
+    switch (granularity) {
+        case Granularity::DAY:
+            firstDay = bucket;
+            break;
+        case Granularity::WEEK:
+            firstDay = bucket * 7 - 3;
+            break;
+        default: {
+            int64_t month = granularity == Granularity::QUARTER ? bucket * 3
+                          : granularity == Granularity::YEAR ? bucket * 12 : bucket;
+            int64_t year = floorDiv(month, 12);
+            firstDay = daysFromCivil(year, static_cast<int>(month - year * 12) + 1, 1);
+            break;
+        }
+    }
+    return firstInstantAtOrAfter(firstDay * SECONDS_PER_DAY);
+}
+
+std::string CalendarBucketer::label(int64_t bucket, Granularity granularity) const {
+    // Room for the widest int64 year and int fields, so no label is cut short
+    char buffer[48];
+    int64_t year;
+    int month, day;
+
+    switch (granularity) {
+        case Granularity::DAY:
+            civilFromDays(bucket, year, month, day);
+            std::snprintf(buffer, sizeof(buffer), "%04lld-%02d-%02d", static_cast<long long>(year), month, day);
+            break;
+        case Granularity::WEEK: {
+            // The ISO week-year is the year of the week's Thursday
+            int64_t thursday = bucket * 7;
+            civilFromDays(thursday, year, month, day);
+            int64_t week = (thursday - daysFromCivil(year, 1, 1)) / 7 + 1;
+            std::snprintf(buffer, sizeof(buffer), "%04lld-W%02lld", static_cast<long long>(year),
+                          static_cast<long long>(week));
+            break;
+        }
+        case Granularity::MONTH:
+            year = floorDiv(bucket, 12);
+            std::snprintf(buffer, sizeof(buffer), "%04lld-%02d", static_cast<long long>(year),
+                          static_cast<int>(bucket - year * 12) + 1);
+            break;
+        case Granularity::QUARTER:
+            year = floorDiv(bucket, 4);
+            std::snprintf(buffer, sizeof(buffer), "%04lld-Q%d", static_cast<long long>(year),
+                          static_cast<int>(bucket - year * 4) + 1);
+            break;
+        case Granularity::YEAR:
+            std::snprintf(buffer, sizeof(buffer), "%04lld", static_cast<long long>(bucket));
+            break;
+    }
+    return buffer;
+}
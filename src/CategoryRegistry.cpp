@@ -0,0 +1,210 @@
+#include "../include/storage/CategoryRegistry.h"
+#include "../include/storage/CsvReader.h"
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+// Quotes every field, doubling embedded quotes, so any text round-trips
+void appendField(std::string& out, const std::string& value) {
+    out += '"';
+    for (char c : value) {
+        if (c == '"') {
+            out += '"';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+// Post-order of the forest described by parents, roots and siblings taken
+// in code order
+std::vector<uint32_t> postOrder(const std::vector<uint32_t>& parents) {
+    size_t count = parents.size();
+
+    // Children grouped by parent: those of code c are children[first[c], first[c + 1])
+    std::vector<uint32_t> first(count + 1, 0);
+    for (uint32_t parent : parents) {
+        if (parent != CategoryRegistry::NONE) {
+            ++first[parent + 1];
+        }
+    }
+    for (size_t code = 0; code < count; ++code) {
+        first[code + 1] += first[code];
+    }
+    std::vector<uint32_t> children(first[count]);
+    std::vector<uint32_t> cursor(first.begin(), first.end() - 1);
+    for (uint32_t code = 0; code < count; ++code) {
+        if (parents[code] != CategoryRegistry::NONE) {
+            children[cursor[parents[code]]++] = code;
+        }
+    }
+
+    // Depth-first, emitting a category once its last child is done
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    std::vector<std::pair<uint32_t, uint32_t>> stack;   // code, next child position
+    for (uint32_t root = 0; root < count; ++root) {
+        if (parents[root] != CategoryRegistry::NONE) continue;
+        stack.emplace_back(root, first[root]);
+        while (!stack.empty()) {
+            uint32_t code = stack.back().first;
+            uint32_t next = stack.back().second;
+            if (next < first[code + 1]) {
+                ++stack.back().second;
+                stack.emplace_back(children[next], first[children[next]]);
+            } else {
+                order.push_back(code);
+                stack.pop_back();
+            }
+        }
+    }
+    return order;
+}
+
+} // namespace
+
+CategoryRegistry::CategoryRegistry()
+    : names(std::make_shared<std::vector<std::string>>()), namesShared(false) {}
+
+uint32_t CategoryRegistry::intern(const std::string& categoryId) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = codes.find(categoryId);
+        if (it != codes.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = codes.find(categoryId);
+    if (it != codes.end()) {
+        return it->second;   // interned between the two locks
+    }
+    if (namesShared) {
+        names = std::make_shared<std::vector<std::string>>(*names);
+        namesShared = false;
+    }
+    uint32_t code = static_cast<uint32_t>(names->size());
+    names->push_back(categoryId);
+    categories.emplace_back();
+    parents.push_back(NONE);
+    codes.emplace(categoryId, code);
+    hierarchy.reset();
+    return code;
+}
+
+uint32_t CategoryRegistry::find(const std::string& categoryId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = codes.find(categoryId);
+    return it != codes.end() ? it->second : NONE;
+}
+
+std::string CategoryRegistry::id(uint32_t code) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return code < names->size() ? (*names)[code] : std::string();
+}
+
+size_t CategoryRegistry::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names->size();
+}
+
+std::shared_ptr<const std::vector<std::string>> CategoryRegistry::ids() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    namesShared = true;
+    return names;
+}
+
+uint32_t CategoryRegistry::define(const Category& category) {
+    uint32_t code = intern(category.id);
+    uint32_t parent = category.parentId ? intern(*category.parentId) : NONE;
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (uint32_t ancestor = parent; ancestor != NONE; ancestor = parents[ancestor]) {
+        if (ancestor == code) {
+            throw std::runtime_error("Category " + category.id + " cannot be nested under " +
+                                     *category.parentId + ", which lies beneath it");
+        }
+    }
+    categories[code] = category;
+    if (parents[code] != parent) {
+        parents[code] = parent;
+        hierarchy.reset();
+    }
+    return code;
+}
+
+std::optional<Category> CategoryRegistry::definition(const std::string& categoryId) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = codes.find(categoryId);
+    return it != codes.end() ? categories[it->second] : std::nullopt;
+}
+
+std::vector<Category> CategoryRegistry::definitions() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<Category> result;
+    for (const auto& category : categories) {
+        if (category) {
+            result.push_back(*category);
+        }
+    }
+    return result;
+}
+
+std::shared_ptr<const CategoryTree> CategoryRegistry::tree() const {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (hierarchy) {
+            return hierarchy;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (!hierarchy) {
+        auto flattened = std::make_shared<CategoryTree>();
+        flattened->parents = parents;
+        flattened->postOrder = postOrder(parents);
+        hierarchy = std::move(flattened);
+    }
+    return hierarchy;
+}
+
+std::string CategoryRegistry::encodeDefinitions() const {
+    std::string out;
+    for (const auto& category : definitions()) {
+        appendField(out, category.id);
+        out += ',';
+        appendField(out, category.name);
+        out += ',';
+        appendField(out, category.color);
+        out += ',';
+        appendField(out, category.parentId.value_or(""));
+        out += '\n';
+    }
+    return out;
+}
+
+size_t CategoryRegistry::decodeDefinitions(std::string_view csv) {
+    CsvReader reader(csv);
+    std::vector<std::string_view> fields;
+    size_t defined = 0;
+    while (reader.next(fields)) {
+        if (fields.size() == 1 && fields[0].empty()) {
+            continue;   // blank line
+        }
+        if (fields.size() != 4 || fields[0].empty()) {
+            throw std::runtime_error("Malformed category record " + std::to_string(reader.recordCount()));
+        }
+        Category category{std::string(fields[0]), std::string(fields[1]), std::string(fields[2])};
+        if (!fields[3].empty()) {
+            category.parentId = std::string(fields[3]);
+        }
+        define(category);
+        ++defined;
+    }
+    if (!reader.error().empty()) {
+        throw std::runtime_error(reader.error());
+    }
+    return defined;
+}
@@ -0,0 +1,188 @@
+#include "../include/storage/CsvReader.h"
+#include "../include/util/ThreadPool.h"
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#define CSV_READER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+bool isSpecial(char c) {
+    return c == ',' || c == '"' || c == '\n' || c == '\r';
+}
+
+// First comma, quote or line break in [p, end), or end
+const char* findSpecial(const char* p, const char* end) {
+#ifdef CSV_READER_SSE2
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i lineFeed = _mm_set1_epi8('\n');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    while (end - p >= 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, comma),
+                                                 _mm_cmpeq_epi8(bytes, quote)),
+                                    _mm_or_si128(_mm_cmpeq_epi8(bytes, lineFeed),
+                                                 _mm_cmpeq_epi8(bytes, carriageReturn)));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+        p += 16;
+    }
+#endif
+    while (p != end && !isSpecial(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+size_t countQuotes(const char* p, const char* end) {
+    size_t count = 0;
+#ifdef CSV_READER_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    while (end - p >= 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        count += __builtin_popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote))));
+        p += 16;
+    }
+#endif
+    for (; p != end; ++p) {
+        count += (*p == '"');
+    }
+    return count;
+}
+
+} // namespace
+
+CsvReader::CsvReader(std::string_view _input)
+    : input(_input), position(0), records(0), unescapedUsed(0) {}
+
+bool CsvReader::next(std::vector<std::string_view>& fields) {
+    fields.clear();
+    unescapedUsed = 0;
+    if (!errorMessage.empty() || position >= input.size()) {
+        return false;
+    }
+
+    const char* begin = input.data();
+    const char* end = begin + input.size();
+    while (true) {
+        std::string_view field;
+        const char* p;
+        if (position < input.size() && input[position] == '"') {
+            if (!readQuoted(field)) {
+                return false;
+            }
+            p = begin + position;
+            if (p != end && *p != ',' && *p != '\n' && *p != '\r') {
+                return fail("Unexpected character after closing quote");
+            }
+        } else {
+            p = findSpecial(begin + position, end);
+            if (p != end && *p == '"') {
+                position = static_cast<size_t>(p - begin);
+                return fail("Quote inside unquoted field");
+            }
+            field = std::string_view(begin + position, static_cast<size_t>(p - begin) - position);
+        }
+        fields.push_back(field);
+
+        if (p == end) {
+            position = input.size();
+            break;
+        }
+        position = static_cast<size_t>(p - begin) + 1;
+        if (*p == ',') {
+            continue;
+        }
+        if (*p == '\r' && position < input.size() && input[position] == '\n') {
+            ++position;
+        }
+        break;
+    }
+
+    ++records;
+    return true;
+}
+
+bool CsvReader::readQuoted(std::string_view& field) {
+    const char* begin = input.data();
+    const char* end = begin + input.size();
+    const char* start = begin + position + 1;
+    const char* p = start;
+    std::string* copy = nullptr;
+
+    while (true) {
+        const char* quote = static_cast<const char*>(std::memchr(p, '"', static_cast<size_t>(end - p)));
+        if (!quote) {
+            return fail("Unterminated quoted field");
+        }
+        if (quote + 1 != end && quote[1] == '"') {
+            if (!copy) {
+                if (unescapedUsed == unescaped.size()) {
+                    unescaped.emplace_back();
+                }
+                copy = &unescaped[unescapedUsed++];
+                copy->assign(start, p);
+            }
+            copy->append(p, quote + 1);   // keeps one of the two quotes
+            p = quote + 2;
+            continue;
+        }
+
+        if (copy) {
+            copy->append(p, quote);
+            field = *copy;
+        } else {
+            field = std::string_view(start, static_cast<size_t>(quote - start));
+        }
+        position = static_cast<size_t>(quote - begin) + 1;
+        return true;
+    }
+}
+
+bool CsvReader::fail(const std::string& message) {
+    errorMessage = message + " in record " + std::to_string(records + 1) +
+                   " (byte " + std::to_string(position) + ")";
+    return false;
+}
+
+std::vector<size_t> CsvReader::split(std::string_view input, size_t count, ThreadPool* pool) {
+    std::vector<size_t> starts(1, 0);
+    if (count <= 1 || input.size() < count) {
+        return starts;
+    }
+
+    size_t step = input.size() / count;
+    std::vector<size_t> quotes(count);
+    ThreadPool::run(pool, count, [&](size_t piece) {
+        const char* from = input.data() + piece * step;
+        const char* to = (piece + 1 == count) ? input.data() + input.size() : from + step;
+        quotes[piece] = countQuotes(from, to);
+    });
+
+    // Each piece ends after the first line feed outside quotes following
+    // its nominal split point; the parity of the quotes before that point
+    // says whether the scan starts inside a quoted field
+    bool inQuotes = false;
+    for (size_t piece = 1; piece < count; ++piece) {
+        inQuotes ^= (quotes[piece - 1] & 1) != 0;
+        bool quoted = inQuotes;
+        size_t i = piece * step;
+        while (i < input.size() && (quoted || input[i] != '\n')) {
+            quoted ^= (input[i] == '"');
+            ++i;
+        }
+        size_t start = i + 1;
+        if (start >= input.size()) {
+            break;
+        }
+        if (start > starts.back()) {
+            starts.push_back(start);
+        }
+    }
+    return starts;
+}
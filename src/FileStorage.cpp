@@ -1,109 +1,417 @@
-#include "../include/storage/FileStorage.h"
-#include <fstream>
-#include <iostream>
-#include <cstdlib>
-
-FileStorage::FileStorage(const std::string& dir) : storageDir(dir) {
-    ensureDirectoryExists();
-}
-
-FileStorage::~FileStorage() {
-    // Implement backup on destruction if needed
-}
-
-void FileStorage::ensureDirectoryExists() {
-    try {
-        std::string cmd;
-        #ifdef _WIN32
-            cmd = "if not exist \"" + storageDir + "\" mkdir \"" + storageDir + "\"";
-        #else
-            cmd = "mkdir -p \"" + storageDir + "\"";
-        #endif
-        std::system(cmd.c_str());
-    } catch (const std::exception& e) {
-        std::cerr << "Error creating storage directory: " << e.what() << std::endl;
-    }
-}
-
-std::string FileStorage::getFilePath(const std::string& key) const {
-    return storageDir + "/" + key + ".json";
-}
-
-void FileStorage::save(const std::string& key, const std::string& value) {
-    try {
-        std::string filePath = getFilePath(key);
-        std::ofstream file(filePath);
-        if (file.is_open()) {
-            file << value;
-            file.close();
-            data[key] = value;
-        } else {
-            throw std::runtime_error("Failed to open file: " + filePath);
-        }
-    } catch (const std::exception& e) {
-        std::cerr << "Error saving to file: " << e.what() << std::endl;
-    }
-}
-
-std::string FileStorage::load(const std::string& key) {
-    try {
-        if (data.find(key) != data.end()) {
-            return data[key];
-        }
-
-        std::string filePath = getFilePath(key);
-        std::ifstream file(filePath);
-        if (file.is_open()) {
-            std::string content((std::istreambuf_iterator<char>(file)),
-                               std::istreambuf_iterator<char>());
-            file.close();
-            data[key] = content;
-            return content;
-        }
-        return "";
-    } catch (const std::exception& e) {
-        std::cerr << "Error loading from file: " << e.what() << std::endl;
-        return "";
-    }
-}
-
-std::string FileStorage::backup() {
-    try {
-        std::string backupDir = storageDir + "/backup";
-        std::string cmd;
-        #ifdef _WIN32
-            cmd = "if not exist \"" + backupDir + "\" mkdir \"" + backupDir + "\"";
-        #else
-            cmd = "mkdir -p \"" + backupDir + "\"";
-        #endif
-        std::system(cmd.c_str());
-        return backupDir;
-    } catch (const std::exception& e) {
-        std::cerr << "Error creating backup: " << e.what() << std::endl;
-        return "";
-    }
-}
-
-bool FileStorage::exists(const std::string& key) {
-    try {
-        std::string filePath = getFilePath(key);
-        std::ifstream file(filePath);
-        bool fileExists = file.good();
-        file.close();
-        return fileExists;
-    } catch (const std::exception& e) {
-        std::cerr << "Error checking file existence: " << e.what() << std::endl;
-        return false;
-    }
-}
-
-void FileStorage::remove(const std::string& key) {
-    try {
-        std::string filePath = getFilePath(key);
-        std::string cmd = "del \"" + filePath + "\"";
-        std::system(cmd.c_str());
-        data.erase(key);
-    } catch (const std::exception& e) {
-        std::cerr << "Error removing file: " << e.what() << std::endl;
-    }
-}
+#include "../include/storage/FileStorage.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <system_error>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const std::chrono::milliseconds DEFAULT_FLUSH_DELAY(50);
+const size_t DEFAULT_CACHE_BUDGET = 16 << 20;
+
+#ifndef _WIN32
+void writeAll(int fd, const std::string& value, const std::string& path) {
+    size_t written = 0;
+    while (written < value.size()) {
+        ssize_t n = ::write(fd, value.data() + written, value.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to write file: " + path);
+        }
+        written += static_cast<size_t>(n);
+    }
+}
+
+// Writes value to path, truncating or appending, and fsyncs it if asked to.
+// An append that fails is cut back off, so retrying it does not repeat the
+// part that made it to the file.
+void writeDescriptor(const std::string& path, const std::string& value, bool append, bool sync) {
+    int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+    int fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    off_t before = append ? ::lseek(fd, 0, SEEK_END) : 0;
+    try {
+        writeAll(fd, value, path);
+        if (sync && ::fsync(fd) != 0) {
+            throw std::runtime_error("Failed to sync file: " + path);
+        }
+    } catch (...) {
+        if (append && before >= 0 && ::ftruncate(fd, before) != 0) {
+            std::cerr << "Failed to undo a partial append to " << path << std::endl;
+        }
+        ::close(fd);
+        throw;
+    }
+    if (::close(fd) != 0) {
+        throw std::runtime_error("Failed to write file: " + path);
+    }
+}
+
+void syncDirectory(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open directory: " + dir);
+    }
+    int result = ::fsync(fd);
+    ::close(fd);
+    if (result != 0) {
+        throw std::runtime_error("Failed to sync directory: " + dir);
+    }
+}
+#endif
+
+} // namespace
+
+FileStorage::FileStorage(const std::string& dir, WriteMode mode, SyncPolicy sync)
+    : cache(DEFAULT_CACHE_BUDGET), storageDir(dir), writeMode(mode), syncPolicy(sync), nextOrder(0),
+      failedWrites(0), flushRequested(false), stopping(false), flushDelay(DEFAULT_FLUSH_DELAY),
+      backupStore(dir + "/backup") {
+    ensureDirectoryExists();
+    if (writeMode == WriteMode::BEHIND) {
+        flusher = std::thread([this] { flushLoop(); });
+    }
+}
+
+FileStorage::~FileStorage() {
+    if (!flusher.joinable()) {
+        return;
+    }
+    try {
+        flush();
+    } catch (const std::exception& e) {
+        std::cerr << "Error flushing storage: " << e.what() << std::endl;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeFlusher.notify_one();
+    flusher.join();
+}
+
+void FileStorage::ensureDirectoryExists() {
+    std::error_code error;
+    std::filesystem::create_directories(storageDir, error);
+    if (error) {
+        std::cerr << "Error creating storage directory: " << error.message() << std::endl;
+    }
+}
+
+std::string FileStorage::getFilePath(const std::string& key) const {
+    // Keys that carry their own extension (e.g. "transactions.wal") are used verbatim
+    if (key.find('.') != std::string::npos) {
+        return storageDir + "/" + key;
+    }
+    return storageDir + "/" + key + ".json";
+}
+
+void FileStorage::writeFile(const std::string& key, const PendingWrite& write) const {
+    std::string filePath = getFilePath(key);
+    bool sync = syncPolicy != SyncPolicy::NONE;
+    if (!write.replace) {
+#ifndef _WIN32
+        writeDescriptor(filePath, write.value, true, sync);
+#else
+        std::error_code error;
+        uintmax_t before = std::filesystem::file_size(filePath, error);
+        std::ofstream file(filePath, std::ios::binary | std::ios::app);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open file: " + filePath);
+        }
+        file.write(write.value.data(), static_cast<std::streamsize>(write.value.size()));
+        file.close();
+        if (!file) {
+            if (!error) {
+                std::filesystem::resize_file(filePath, before, error);
+            }
+            throw std::runtime_error("Failed to append to file: " + filePath);
+        }
+#endif
+        return;
+    }
+
+    // Write to a temporary file and rename it over the target so a crash
+    // mid-write never leaves a truncated file behind
+    std::string tempPath = filePath + ".tmp";
+#ifndef _WIN32
+    writeDescriptor(tempPath, write.value, false, sync);
+#else
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + tempPath);
+    }
+    file.write(write.value.data(), static_cast<std::streamsize>(write.value.size()));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Failed to write file: " + tempPath);
+    }
+    std::remove(filePath.c_str());
+#endif
+    if (std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+        throw std::runtime_error("Failed to replace file: " + filePath);
+    }
+#ifndef _WIN32
+    if (syncPolicy == SyncPolicy::FULL) {
+        syncDirectory(storageDir);
+    }
+#endif
+}
+
+void FileStorage::save(const std::string& key, const std::string& value) {
+    if (writeMode == WriteMode::BEHIND) {
+        queue(key, value, true);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    PendingWrite write;
+    write.replace = true;
+    write.value = value;
+    writeFile(key, write);
+    cache.put(key, std::move(write.value));
+}
+
+void FileStorage::append(const std::string& key, const std::string& value) {
+    if (writeMode == WriteMode::BEHIND) {
+        queue(key, value, false);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    PendingWrite write;
+    write.value = value;
+    writeFile(key, write);
+    cache.append(key, value);
+}
+
+void FileStorage::queue(const std::string& key, const std::string& value, bool replace) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = pending.find(key);
+    if (it == pending.end()) {
+        it = pending.emplace(key, PendingWrite()).first;
+        it->second.order = nextOrder++;
+    }
+
+    // A save supersedes whatever was queued for the key and moves it to the
+    // back of the order; appends pile up behind it, or behind the file's
+    // content when nothing was saved, and keep the key's place
+    PendingWrite& write = it->second;
+    if (replace) {
+        write.replace = true;
+        write.value = value;
+        write.order = nextOrder++;
+        cache.put(key, value);
+    } else {
+        write.value += value;
+        cache.append(key, value);
+    }
+    wakeFlusher.notify_one();
+}
+
+void FileStorage::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wakeFlusher.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) {
+            return;
+        }
+        // Let writes in quick succession pile up; flush() and shutdown cut
+        // the wait short
+        wakeFlusher.wait_for(lock, flushDelay, [this] { return stopping || flushRequested; });
+        flushRequested = false;
+        flushing.swap(pending);
+
+        std::vector<std::map<std::string, PendingWrite>::iterator> batch;
+        for (auto it = flushing.begin(); it != flushing.end(); ++it) {
+            batch.push_back(it);
+        }
+        std::sort(batch.begin(), batch.end(),
+                  [](const auto& a, const auto& b) { return a->second.order < b->second.order; });
+
+        // Only the flusher touches flushing's entries, so they are written
+        // without the lock; readers just check which keys it holds
+        lock.unlock();
+        size_t written = 0;
+        for (; written < batch.size(); ++written) {
+            try {
+                writeFile(batch[written]->first, batch[written]->second);
+            } catch (const std::exception& e) {
+                std::cerr << "Error writing to file: " << e.what() << std::endl;
+                break;
+            }
+        }
+        lock.lock();
+
+        if (written < batch.size()) {
+            // Later keys wait for the failed one, so the files never get
+            // ahead of each other; newer writes of the same keys go on top
+            ++failedWrites;
+            if (stopping) {
+                std::cerr << "Discarding " << (batch.size() - written)
+                          << " queued writes to " << storageDir << std::endl;
+            }
+            for (size_t i = written; i < batch.size() && !stopping; ++i) {
+                if (removed.count(batch[i]->first) > 0) {
+                    continue;   // the file is gone; only newer writes count
+                }
+                PendingWrite write = std::move(batch[i]->second);
+                auto newer = pending.find(batch[i]->first);
+                if (newer != pending.end()) {
+                    if (newer->second.replace) {
+                        write.replace = true;
+                        write.value = std::move(newer->second.value);
+                        write.order = newer->second.order;
+                    } else {
+                        write.value += newer->second.value;
+                    }
+                }
+                pending[batch[i]->first] = std::move(write);
+            }
+        }
+        flushing.clear();
+        removed.clear();
+        flushed.notify_all();
+    }
+}
+
+void FileStorage::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (writeMode != WriteMode::BEHIND) {
+        return;
+    }
+    uint64_t failures = failedWrites;
+    if (!pending.empty()) {
+        flushRequested = true;
+        wakeFlusher.notify_one();
+    }
+    flushed.wait(lock, [&] {
+        return failedWrites != failures || (pending.empty() && flushing.empty());
+    });
+    if (failedWrites != failures) {
+        throw std::runtime_error("Failed to flush storage: " + storageDir);
+    }
+}
+
+void FileStorage::setCacheBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.setBudget(bytes);
+}
+
+CacheStats FileStorage::cacheStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.stats();
+}
+
+void FileStorage::setFlushDelay(std::chrono::milliseconds delay) {
+    std::lock_guard<std::mutex> lock(mutex);
+    flushDelay = delay;
+}
+
+void FileStorage::settle(std::unique_lock<std::mutex>& lock, const std::string& key) {
+    uint64_t failures = failedWrites;
+    while ((pending.count(key) > 0 || flushing.count(key) > 0) && failedWrites == failures) {
+        if (pending.count(key) > 0) {
+            flushRequested = true;
+            wakeFlusher.notify_one();
+        }
+        flushed.wait(lock);
+    }
+}
+
+std::string FileStorage::load(const std::string& key) {
+    std::unique_lock<std::mutex> lock(mutex);
+    try {
+        if (const std::string* cached = cache.find(key)) {
+            return *cached;
+        }
+        settle(lock, key);   // writes queued for an uncached key
+
+        std::string filePath = getFilePath(key);
+        std::ifstream file(filePath, std::ios::binary);
+        if (file.is_open()) {
+            std::string content((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+            file.close();
+            cache.put(key, content);
+            return content;
+        }
+        return "";
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading from file: " << e.what() << std::endl;
+        return "";
+    }
+}
+
+std::string FileStorage::backup() {
+    try {
+        flush();
+        std::vector<BackupSource> sources;
+        {
+            // Nothing is written while the files are mapped; the mappings
+            // then hold what was captured however the files change after
+            std::unique_lock<std::mutex> lock(mutex);
+            flushed.wait(lock, [this] { return flushing.empty(); });
+            sources = BackupStore::capture(storageDir);
+        }
+        return backupStore.write(sources);
+    } catch (const std::exception& e) {
+        std::cerr << "Error creating backup: " << e.what() << std::endl;
+        return "";
+    }
+}
+
+bool FileStorage::exists(const std::string& key) {
+    try {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (pending.count(key) > 0 || flushing.count(key) > 0) {
+                return true;
+            }
+        }
+        std::error_code error;
+        return std::filesystem::is_regular_file(getFilePath(key), error);
+    } catch (const std::exception& e) {
+        std::cerr << "Error checking file existence: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void FileStorage::remove(const std::string& key) {
+    std::unique_lock<std::mutex> lock(mutex);
+    try {
+        pending.erase(key);
+        if (flushing.count(key) > 0) {
+            removed.insert(key);   // not to be retried if the write fails
+        }
+        settle(lock, key);   // a write already under way would recreate the file
+        cache.erase(key);
+        std::error_code error;
+        std::filesystem::remove(getFilePath(key), error);
+        if (error) {
+            throw std::runtime_error("Failed to remove " + getFilePath(key) + ": " + error.message());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error removing file: " << e.what() << std::endl;
+    }
+}
+
+std::shared_ptr<const MappedFile> FileStorage::map(const std::string& key) {
+    // Mapped values bypass the in-memory cache: the page cache already holds
+    // them, once whatever is queued for the key has been written
+    if (writeMode == WriteMode::BEHIND) {
+        std::unique_lock<std::mutex> lock(mutex);
+        settle(lock, key);
+    }
+    return MappedFile::open(getFilePath(key));
+}
@@ -1,122 +1,439 @@
-#include "../include/services/ImportExportService.h"
-#include "../include/storage/TransactionRepository.h"
-#include <sstream>
-#include <iomanip>
-
-ImportExportService::ImportExportService(std::shared_ptr<TransactionRepository> repo)
-    : repository(repo) {}
-
-ImportExportService::~ImportExportService() {}
-
-std::string ImportExportService::transactionToJSON(const Transaction& tx) const {
-    std::stringstream ss;
-    ss << "{ \"id\": \"" << tx.id << "\", \"amount\": " << tx.amount
-       << ", \"type\": \"" << (tx.type == TransactionType::INCOME ? "INCOME" : "EXPENSE")
-       << "\", \"date\": " << tx.date << ", \"categoryId\": \"" << tx.categoryId
-       << "\", \"note\": \"" << tx.note << "\" }";
-    return ss.str();
-}
-
-Transaction ImportExportService::jsonToTransaction(const std::string& jsonStr) const {
-    Transaction tx;
-    // Simplified parsing - in production use a proper JSON library
-    return tx;
-}
-
-std::string ImportExportService::exportToJSON() const {
-    std::stringstream ss;
-    ss << "[\n";
-    auto transactions = repository->getAll();
-
-    for (size_t i = 0; i < transactions.size(); ++i) {
-        const auto& tx = transactions[i];
-        ss << "  { \"id\": \"" << tx.id << "\", \"amount\": " << tx.amount
-           << ", \"type\": \"" << (tx.type == TransactionType::INCOME ? "INCOME" : "EXPENSE")
-           << "\", \"date\": " << tx.date << ", \"categoryId\": \"" << tx.categoryId
-           << "\", \"note\": \"" << tx.note << "\" }";
-        if (i < transactions.size() - 1) ss << ",";
-        ss << "\n";
-    }
-
-    ss << "]";
-    return ss.str();
-}
-
-ImportResult ImportExportService::importFromJSON(const std::string& jsonStr) {
-    ImportResult result;
-    result.success = false;
-    result.importedCount = 0;
-
-    try {
-        // Simplified parsing - in production use a proper JSON library
-        result.success = true;
-        return result;
-    } catch (const std::exception& e) {
-        result.errorMessage = std::string("Parse error: ") + e.what();
-        return result;
-    }
-}
-
-std::string ImportExportService::exportToCSV() const {
-    std::stringstream ss;
-    ss << "ID,Amount,Type,Date,CategoryId,Note,CreatedAt,UpdatedAt,IsDeleted\n";
-
-    auto transactions = repository->getAll();
-    for (const auto& tx : transactions) {
-        ss << tx.id << ","
-           << tx.amount << ","
-           << (tx.type == TransactionType::INCOME ? "INCOME" : "EXPENSE") << ","
-           << tx.date << ","
-           << tx.categoryId << ","
-           << tx.note << ","
-           << tx.createdAt << ","
-           << tx.updatedAt << ","
-           << (tx.isDeleted ? "true" : "false") << "\n";
-    }
-
-    return ss.str();
-}
-
-bool ImportExportService::importFromCSV(const std::string& csv) {
-    try {
-        std::istringstream stream(csv);
-        std::string line;
-
-        // Skip header
-        std::getline(stream, line);
-
-        while (std::getline(stream, line)) {
-            if (line.empty()) continue;
-
-            std::istringstream lineStream(line);
-            std::string id, amountStr, typeStr, dateStr, categoryId, note, createdStr, updatedStr, deletedStr;
-
-            std::getline(lineStream, id, ',');
-            std::getline(lineStream, amountStr, ',');
-            std::getline(lineStream, typeStr, ',');
-            std::getline(lineStream, dateStr, ',');
-            std::getline(lineStream, categoryId, ',');
-            std::getline(lineStream, note, ',');
-            std::getline(lineStream, createdStr, ',');
-            std::getline(lineStream, updatedStr, ',');
-            std::getline(lineStream, deletedStr, ',');
-
-            Transaction tx;
-            tx.id = id;
-            tx.amount = std::stod(amountStr);
-            tx.type = (typeStr == "INCOME") ? TransactionType::INCOME : TransactionType::EXPENSE;
-            tx.date = std::stol(dateStr);
-            tx.categoryId = categoryId;
-            tx.note = note;
-            tx.createdAt = std::stol(createdStr);
-            tx.updatedAt = std::stol(updatedStr);
-            tx.isDeleted = (deletedStr == "true");
-
-            repository->add(tx);
-        }
-
-        return true;
-    } catch (const std::exception& e) {
-        return false;
-    }
-}
+#include "../include/services/ImportExportService.h"
+#include "../include/storage/TransactionRepository.h"
+#include "../include/storage/JsonReader.h"
+#include "../include/storage/CsvReader.h"
+#include "../include/storage/MappedFile.h"
+#include "../include/util/ThreadPool.h"
+#include <charconv>
+#include <stdexcept>
+
+namespace {
+
+// Builds transactions from the events of an exported JSON array, one record
+// per top-level element, and stages each in the batch as its object closes
+class TransactionImportHandler : public JsonHandler {
+private:
+    enum class Field { NONE, ID, AMOUNT, TYPE, DATE, CATEGORY_ID, NOTE };
+
+    TransactionBatch& batch;
+    ImportResult& result;
+    std::string abortReason;
+
+    int depth;          // 1 inside the array, 2 inside a record
+    int skipping;       // open containers being skipped
+    size_t record;
+    Field field;
+    Transaction tx;
+    bool hasAmount, hasType, hasDate;
+    std::string recordError;
+
+public:
+    TransactionImportHandler(TransactionBatch& _batch, ImportResult& _result)
+        : batch(_batch), result(_result), depth(0), skipping(0), record(0), field(Field::NONE),
+          hasAmount(false), hasType(false), hasDate(false) {}
+
+    const std::string& abortMessage() const { return abortReason; }
+
+    bool startObject() override { return enterContainer(true); }
+    bool startArray() override { return enterContainer(false); }
+    bool endObject() override { return leaveContainer(); }
+    bool endArray() override { return leaveContainer(); }
+
+    bool key(std::string_view name) override {
+        if (skipping > 0) return true;
+        if (name == "id") field = Field::ID;
+        else if (name == "amount") field = Field::AMOUNT;
+        else if (name == "type") field = Field::TYPE;
+        else if (name == "date") field = Field::DATE;
+        else if (name == "categoryId") field = Field::CATEGORY_ID;
+        else if (name == "note") field = Field::NOTE;
+        else field = Field::NONE;
+        return true;
+    }
+
+    bool string(std::string_view value) override {
+        if (!scalar()) return depth > 0;
+        switch (field) {
+            case Field::ID:          tx.id.assign(value.data(), value.size()); break;
+            case Field::CATEGORY_ID: tx.categoryId.assign(value.data(), value.size()); break;
+            case Field::NOTE:        tx.note.assign(value.data(), value.size()); break;
+            case Field::TYPE:
+                if (value == "INCOME") tx.type = TransactionType::INCOME;
+                else if (value == "EXPENSE") tx.type = TransactionType::EXPENSE;
+                else reject("type must be \"INCOME\" or \"EXPENSE\"");
+                hasType = true;
+                break;
+            case Field::AMOUNT: reject("amount must be a number"); break;
+            case Field::DATE:   reject("date must be an integer timestamp"); break;
+            case Field::NONE:   break;
+        }
+        return true;
+    }
+
+    bool number(std::string_view text) override {
+        if (!scalar()) return depth > 0;
+        const char* end = text.data() + text.size();
+        switch (field) {
+            case Field::AMOUNT:
+                if (!Money::parse(text, tx.amount)) reject("amount is out of range");
+                hasAmount = true;
+                break;
+            case Field::DATE: {
+                int64_t date = 0;
+                auto parsed = std::from_chars(text.data(), end, date);
+                if (parsed.ec != std::errc() || parsed.ptr != end) reject("date must be an integer timestamp");
+                tx.date = static_cast<time_t>(date);
+                hasDate = true;
+                break;
+            }
+            case Field::NONE: break;
+            default: rejectWrongType(); break;
+        }
+        return true;
+    }
+
+    bool boolean(bool) override {
+        if (!scalar()) return depth > 0;
+        if (field != Field::NONE) rejectWrongType();
+        return true;
+    }
+
+    bool null() override {
+        if (!scalar()) return depth > 0;
+        if (field == Field::AMOUNT || field == Field::TYPE || field == Field::DATE) rejectWrongType();
+        return true;
+    }
+
+private:
+    bool enterContainer(bool object) {
+        if (skipping > 0) {
+            ++skipping;
+        } else if (depth == 0) {
+            if (!object) {
+                depth = 1;
+                return true;
+            }
+            abortReason = "Expected a top-level array of transactions";
+            return false;
+        } else if (depth == 1) {
+            beginRecord();
+            if (object) {
+                depth = 2;
+            } else {
+                reject("expected an object");
+                skipping = 1;
+            }
+        } else {
+            if (field != Field::NONE) rejectWrongType();
+            skipping = 1;
+        }
+        return true;
+    }
+
+    bool leaveContainer() {
+        if (skipping > 0) {
+            if (--skipping == 0 && depth == 1) {
+                finishRecord();
+            }
+        } else if (depth == 2) {
+            finishRecord();
+            depth = 1;
+        } else {
+            depth = 0;
+        }
+        return true;
+    }
+
+    // Handles a scalar outside a record; false means it belongs to a field
+    bool scalar() {
+        if (skipping > 0) return false;
+        if (depth == 0) {
+            abortReason = "Expected a top-level array of transactions";
+            return false;
+        }
+        if (depth == 1) {
+            beginRecord();
+            reject("expected an object");
+            finishRecord();
+            return false;
+        }
+        return true;
+    }
+
+    void beginRecord() {
+        tx = Transaction();
+        field = Field::NONE;
+        hasAmount = hasType = hasDate = false;
+        recordError.clear();
+    }
+
+    void reject(const std::string& message) {
+        if (recordError.empty()) {
+            recordError = message;
+        }
+    }
+
+    void rejectWrongType() {
+        static const char* const NAMES[] = {"", "id", "amount", "type", "date", "categoryId", "note"};
+        reject(std::string(NAMES[static_cast<int>(field)]) + " has the wrong type");
+    }
+
+    void finishRecord() {
+        if (recordError.empty()) {
+            if (!hasAmount) reject("missing field \"amount\"");
+            else if (!hasType) reject("missing field \"type\"");
+            else if (!hasDate) reject("missing field \"date\"");
+        }
+        if (recordError.empty()) {
+            try {
+                batch.add(tx);
+            } catch (const std::exception& e) {
+                reject(e.what());
+            }
+        }
+        if (!recordError.empty()) {
+            ++result.rejectedCount;
+            if (result.recordErrors.size() < ImportResult::MAX_REPORTED_ERRORS) {
+                result.recordErrors.push_back({record, recordError});
+            }
+        }
+        ++record;
+    }
+};
+
+// Columns of the CSV layout exportToCSV writes that an import reads
+const size_t CSV_IMPORTED_FIELDS = 6;   // ID, Amount, Type, Date, CategoryId, Note
+
+template <typename T>
+T parseCSVNumber(std::string_view text, const char* column) {
+    T value{};
+    const char* end = text.data() + text.size();
+    auto parsed = std::from_chars(text.data(), end, value);
+    if (parsed.ec != std::errc() || parsed.ptr != end) {
+        throw std::runtime_error(std::string("Invalid ") + column + ": " + std::string(text));
+    }
+    return value;
+}
+
+// Transactions of one record-aligned piece of a CSV export; throws on the
+// first malformed row
+std::vector<Transaction> parseCSVRows(std::string_view text, bool skipHeader) {
+    CsvReader reader(text);
+    std::vector<std::string_view> fields;
+    std::vector<Transaction> rows;
+
+    if (skipHeader) {
+        reader.next(fields);
+    }
+    while (reader.next(fields)) {
+        if (fields.size() == 1 && fields[0].empty()) {
+            continue;   // blank line
+        }
+        if (fields.size() < CSV_IMPORTED_FIELDS) {
+            throw std::runtime_error("Too few fields in CSV record " + std::to_string(reader.recordCount()));
+        }
+
+        Transaction tx;
+        tx.id = fields[0];
+        if (!Money::parse(fields[1], tx.amount)) {
+            throw std::runtime_error("Invalid amount: " + std::string(fields[1]));
+        }
+        tx.type = (fields[2] == "INCOME") ? TransactionType::INCOME : TransactionType::EXPENSE;
+        tx.date = static_cast<time_t>(parseCSVNumber<int64_t>(fields[3], "date"));
+        tx.categoryId = fields[4];
+        tx.note = fields[5];
+        rows.push_back(std::move(tx));
+    }
+    if (!reader.error().empty()) {
+        throw std::runtime_error(reader.error());
+    }
+    return rows;
+}
+
+} // namespace
+
+ImportExportService::ImportExportService(std::shared_ptr<TransactionRepository> repo)
+    : repository(repo) {}
+
+ImportExportService::~ImportExportService() {}
+
+void ImportExportService::writeJSONString(OutputSink& sink, const std::string& value) const {
+    static const char HEX[] = "0123456789abcdef";
+
+    sink.put('"');
+    size_t runStart = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(value[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        sink.write(value.data() + runStart, i - runStart);
+        runStart = i + 1;
+        switch (c) {
+            case '"':  sink.write("\\\"", 2); break;
+            case '\\': sink.write("\\\\", 2); break;
+            case '\n': sink.write("\\n", 2); break;
+            case '\r': sink.write("\\r", 2); break;
+            case '\t': sink.write("\\t", 2); break;
+            default: {
+                char escape[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+                sink.write(escape, sizeof(escape));
+            }
+        }
+    }
+    sink.write(value.data() + runStart, value.size() - runStart);
+    sink.put('"');
+}
+
+void ImportExportService::writeCSVField(OutputSink& sink, const std::string& value) const {
+    // RFC 4180: quote fields holding a delimiter, quote or line break and
+    // double any quotes inside
+    if (value.find_first_of(",\"\r\n") == std::string::npos) {
+        sink.write(value);
+        return;
+    }
+
+    sink.put('"');
+    size_t runStart = 0;
+    for (size_t quote = value.find('"'); quote != std::string::npos; quote = value.find('"', quote + 1)) {
+        sink.write(value.data() + runStart, quote + 1 - runStart);
+        sink.put('"');
+        runStart = quote + 1;
+    }
+    sink.write(value.data() + runStart, value.size() - runStart);
+    sink.put('"');
+}
+
+void ImportExportService::writeTransactionJSON(OutputSink& sink, const Transaction& tx) const {
+    sink.write("{ \"id\": ");
+    writeJSONString(sink, tx.id);
+    sink.write(", \"amount\": ");
+    sink.writeMoney(tx.amount);
+    sink.write(tx.type == TransactionType::INCOME ? ", \"type\": \"INCOME\", \"date\": "
+                                                  : ", \"type\": \"EXPENSE\", \"date\": ");
+    sink.writeInt(static_cast<int64_t>(tx.date));
+    sink.write(", \"categoryId\": ");
+    writeJSONString(sink, tx.categoryId);
+    sink.write(", \"note\": ");
+    writeJSONString(sink, tx.note);
+    sink.write(" }");
+}
+
+void ImportExportService::exportToJSON(OutputSink& sink) const {
+    sink.write("[\n");
+
+    bool first = true;
+    repository->forEach([&](const Transaction& tx) {
+        sink.write(first ? "  " : ",\n  ");
+        first = false;
+        writeTransactionJSON(sink, tx);
+    });
+    if (!first) sink.put('\n');
+
+    sink.put(']');
+    sink.flush();
+}
+
+std::string ImportExportService::exportToJSON() const {
+    std::string json;
+    OutputSink sink(&json);
+    exportToJSON(sink);
+    return json;
+}
+
+ImportResult ImportExportService::importFromJSON(InputSource& source) {
+    ImportResult result;
+
+    try {
+        JsonReader reader(source);
+        TransactionBatch batch = repository->beginBatch();
+        TransactionImportHandler handler(batch, result);
+        if (reader.parse(handler)) {
+            result.importedCount = static_cast<int>(batch.commit());
+            result.success = true;
+            if (result.rejectedCount > 0) {
+                result.errorMessage = std::to_string(result.rejectedCount) + " record(s) rejected";
+            }
+        } else {
+            result.errorMessage = "Parse error: " +
+                (handler.abortMessage().empty() ? reader.error() : handler.abortMessage());
+        }
+    } catch (const std::exception& e) {
+        result.success = false;
+        result.errorMessage = std::string("Import failed: ") + e.what();
+    }
+    return result;
+}
+
+ImportResult ImportExportService::importFromJSON(const std::string& json) {
+    InputSource source(std::string_view(json.data(), json.size()));
+    return importFromJSON(source);
+}
+
+void ImportExportService::exportToCSV(OutputSink& sink) const {
+    sink.write("ID,Amount,Type,Date,CategoryId,Note,CreatedAt,UpdatedAt,IsDeleted\n");
+
+    repository->forEach([&](const Transaction& tx) {
+        writeCSVField(sink, tx.id);
+        sink.put(',');
+        sink.writeMoney(tx.amount);
+        sink.write(tx.type == TransactionType::INCOME ? ",INCOME," : ",EXPENSE,");
+        sink.writeInt(static_cast<int64_t>(tx.date));
+        sink.put(',');
+        writeCSVField(sink, tx.categoryId);
+        sink.put(',');
+        writeCSVField(sink, tx.note);
+        sink.put(',');
+        sink.writeInt(static_cast<int64_t>(tx.createdAt));
+        sink.put(',');
+        sink.writeInt(static_cast<int64_t>(tx.updatedAt));
+        sink.write(tx.isDeleted ? ",true\n" : ",false\n");
+    });
+
+    sink.flush();
+}
+
+std::string ImportExportService::exportToCSV() const {
+    std::string csv;
+    OutputSink sink(&csv);
+    exportToCSV(sink);
+    return csv;
+}
+
+bool ImportExportService::importFromCSV(std::string_view csv, ThreadPool* pool) {
+    try {
+        std::vector<size_t> starts = CsvReader::split(csv, pool ? pool->size() : 1, pool);
+        std::vector<std::vector<Transaction>> pieces(starts.size());
+        ThreadPool::run(pool, starts.size(), [&](size_t piece) {
+            size_t end = (piece + 1 < starts.size()) ? starts[piece + 1] : csv.size();
+            pieces[piece] = parseCSVRows(csv.substr(starts[piece], end - starts[piece]), piece == 0);
+        });
+
+        size_t total = 0;
+        for (const auto& rows : pieces) {
+            total += rows.size();
+        }
+        TransactionBatch batch = repository->beginBatch();
+        batch.reserve(total);
+        for (auto& rows : pieces) {
+            for (const auto& tx : rows) {
+                batch.add(tx);
+            }
+            std::vector<Transaction>().swap(rows);
+        }
+
+        batch.commit();
+        return true;
+    } catch (const std::exception& e) {
+        return false;
+    }
+}
+
+bool ImportExportService::importFromCSVFile(const std::string& path, ThreadPool* pool) {
+    auto file = MappedFile::open(path);
+    if (!file) {
+        return false;
+    }
+    return importFromCSV(std::string_view(file->data(), file->size()), pool);
+}
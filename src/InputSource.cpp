@@ -0,0 +1,81 @@
+#include "../include/storage/InputSource.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+InputSource::InputSource(const std::string& path, size_t bufferSize)
+    : source(Source::FD), ownsFd(true), stream(nullptr), buffer(bufferSize > 0 ? bufferSize : 1),
+      window(buffer.data()), windowSize(0), consumedBefore(0), exhausted(false) {
+#ifdef _WIN32
+    fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+#endif
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    }
+}
+
+InputSource::InputSource(int _fd, size_t bufferSize)
+    : source(Source::FD), fd(_fd), ownsFd(false), stream(nullptr), buffer(bufferSize > 0 ? bufferSize : 1),
+      window(buffer.data()), windowSize(0), consumedBefore(0), exhausted(false) {}
+
+InputSource::InputSource(std::istream& in, size_t bufferSize)
+    : source(Source::STREAM), fd(-1), ownsFd(false), stream(&in), buffer(bufferSize > 0 ? bufferSize : 1),
+      window(buffer.data()), windowSize(0), consumedBefore(0), exhausted(false) {}
+
+InputSource::InputSource(std::string_view text)
+    : source(Source::MEMORY), fd(-1), ownsFd(false), stream(nullptr),
+      window(text.data()), windowSize(text.size()), consumedBefore(0), exhausted(true) {}
+
+InputSource::~InputSource() {
+    if (ownsFd) {
+#ifdef _WIN32
+        _close(fd);
+#else
+        ::close(fd);
+#endif
+    }
+}
+
+bool InputSource::refill() {
+    consumedBefore += windowSize;
+    windowSize = 0;
+    if (exhausted) {
+        return false;
+    }
+
+    if (source == Source::FD) {
+        for (;;) {
+#ifdef _WIN32
+            int got = _read(fd, buffer.data(), static_cast<unsigned int>(buffer.size()));
+#else
+            ssize_t got = ::read(fd, buffer.data(), buffer.size());
+#endif
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("Read failed: ") + std::strerror(errno));
+            }
+            windowSize = static_cast<size_t>(got);
+            break;
+        }
+    } else {
+        stream->read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        windowSize = static_cast<size_t>(stream->gcount());
+        if (stream->bad()) {
+            throw std::runtime_error("Read failed: input stream is in a failed state");
+        }
+    }
+
+    window = buffer.data();
+    exhausted = windowSize == 0;
+    return !exhausted;
+}
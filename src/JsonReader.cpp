@@ -0,0 +1,327 @@
+#include "../include/storage/JsonReader.h"
+#include <cstdint>
+
+namespace {
+
+bool isWhitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool isNumberChar(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+bool isPlainStringByte(char c) {
+    return c != '"' && c != '\\' && static_cast<unsigned char>(c) >= 0x20;
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?
+bool isValidNumber(std::string_view text) {
+    size_t i = 0;
+    size_t n = text.size();
+    if (i < n && text[i] == '-') ++i;
+    if (i == n) return false;
+    if (text[i] == '0') {
+        ++i;
+    } else if (isDigit(text[i])) {
+        while (i < n && isDigit(text[i])) ++i;
+    } else {
+        return false;
+    }
+    if (i < n && text[i] == '.') {
+        ++i;
+        if (i == n || !isDigit(text[i])) return false;
+        while (i < n && isDigit(text[i])) ++i;
+    }
+    if (i < n && (text[i] == 'e' || text[i] == 'E')) {
+        ++i;
+        if (i < n && (text[i] == '+' || text[i] == '-')) ++i;
+        if (i == n || !isDigit(text[i])) return false;
+        while (i < n && isDigit(text[i])) ++i;
+    }
+    return i == n;
+}
+
+void appendUtf8(std::string& out, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+} // namespace
+
+JsonReader::JsonReader(InputSource& _source)
+    : source(_source), windowStart(_source.data()), cursor(_source.data()),
+      limit(_source.data() + _source.size()), windowBase(_source.windowOffset()) {}
+
+bool JsonReader::fill() {
+    while (cursor == limit) {
+        if (!source.refill()) {
+            return false;
+        }
+        windowStart = cursor = source.data();
+        limit = cursor + source.size();
+        windowBase = source.windowOffset();
+    }
+    return true;
+}
+
+int JsonReader::skipWhitespace() {
+    for (;;) {
+        while (cursor < limit && isWhitespace(*cursor)) {
+            ++cursor;
+        }
+        if (cursor < limit) {
+            return static_cast<unsigned char>(*cursor);
+        }
+        if (!fill()) {
+            return -1;
+        }
+    }
+}
+
+int JsonReader::nextChar() {
+    if (cursor == limit && !fill()) {
+        return -1;
+    }
+    return static_cast<unsigned char>(*cursor++);
+}
+
+bool JsonReader::fail(const std::string& message) {
+    errorMessage = message + " at byte " + std::to_string(offset());
+    return false;
+}
+
+bool JsonReader::readString(std::string_view& value) {
+    ++cursor;   // opening quote
+
+    // Fast path: the whole string is in this window and has no escapes
+    const char* end = cursor;
+    while (end < limit && isPlainStringByte(*end)) {
+        ++end;
+    }
+    if (end < limit && *end == '"') {
+        value = std::string_view(cursor, static_cast<size_t>(end - cursor));
+        cursor = end + 1;
+        return true;
+    }
+
+    scratch.assign(cursor, end);
+    cursor = end;
+    for (;;) {
+        if (cursor == limit && !fill()) {
+            return fail("Unterminated string");
+        }
+        end = cursor;
+        while (end < limit && isPlainStringByte(*end)) {
+            ++end;
+        }
+        scratch.append(cursor, end);
+        cursor = end;
+        if (cursor == limit) {
+            continue;
+        }
+
+        char c = *cursor++;
+        if (c == '"') {
+            value = scratch;
+            return true;
+        }
+        if (c != '\\') {
+            return fail("Unescaped control character in string");
+        }
+        if (!readEscape()) {
+            return false;
+        }
+    }
+}
+
+bool JsonReader::readEscape() {
+    auto readHex4 = [this](uint32_t& unit) {
+        unit = 0;
+        for (int i = 0; i < 4; ++i) {
+            int c = nextChar();
+            unit <<= 4;
+            if (c >= '0' && c <= '9') unit |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f') unit |= static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') unit |= static_cast<uint32_t>(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    };
+
+    int c = nextChar();
+    switch (c) {
+        case '"':  scratch += '"'; return true;
+        case '\\': scratch += '\\'; return true;
+        case '/':  scratch += '/'; return true;
+        case 'b':  scratch += '\b'; return true;
+        case 'f':  scratch += '\f'; return true;
+        case 'n':  scratch += '\n'; return true;
+        case 'r':  scratch += '\r'; return true;
+        case 't':  scratch += '\t'; return true;
+        case 'u': {
+            uint32_t unit;
+            if (!readHex4(unit)) {
+                return fail("Invalid \\u escape");
+            }
+            if (unit >= 0xD800 && unit <= 0xDBFF) {
+                uint32_t low;
+                if (nextChar() != '\\' || nextChar() != 'u' || !readHex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                    return fail("Unpaired surrogate in \\u escape");
+                }
+                unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+            } else if (unit >= 0xDC00 && unit <= 0xDFFF) {
+                return fail("Unpaired surrogate in \\u escape");
+            }
+            appendUtf8(scratch, unit);
+            return true;
+        }
+        default:
+            return fail("Invalid escape in string");
+    }
+}
+
+bool JsonReader::readNumber(std::string_view& text) {
+    const char* end = cursor;
+    while (end < limit && isNumberChar(*end)) {
+        ++end;
+    }
+    if (end < limit) {
+        text = std::string_view(cursor, static_cast<size_t>(end - cursor));
+        cursor = end;
+    } else {
+        // Runs into the next window
+        scratch.assign(cursor, end);
+        cursor = end;
+        while (fill() && isNumberChar(*cursor)) {
+            scratch += *cursor++;
+        }
+        text = scratch;
+    }
+    return isValidNumber(text) || fail("Invalid number");
+}
+
+bool JsonReader::readLiteral(const char* word) {
+    for (const char* p = word; *p; ++p) {
+        if (nextChar() != static_cast<unsigned char>(*p)) {
+            return fail(std::string("Invalid literal, expected ") + word);
+        }
+    }
+    return true;
+}
+
+bool JsonReader::parse(JsonHandler& handler) {
+    enum class State { VALUE, FIRST_VALUE, FIRST_KEY, KEY, AFTER_VALUE };
+    State state = State::VALUE;
+    containers.clear();
+    errorMessage.clear();
+
+    for (;;) {
+        int c = skipWhitespace();
+
+        switch (state) {
+            case State::FIRST_VALUE:
+                if (c == ']') {
+                    ++cursor;
+                    containers.pop_back();
+                    if (!handler.endArray()) return false;
+                    state = State::AFTER_VALUE;
+                    break;
+                }
+                // fall through
+            case State::VALUE: {
+                bool accepted;
+                if (c == '{' || c == '[') {
+                    if (containers.size() >= MAX_DEPTH) {
+                        return fail("Nesting too deep");
+                    }
+                    ++cursor;
+                    containers.push_back(static_cast<char>(c));
+                    accepted = (c == '{') ? handler.startObject() : handler.startArray();
+                    state = (c == '{') ? State::FIRST_KEY : State::FIRST_VALUE;
+                    if (!accepted) return false;
+                    break;
+                }
+
+                if (c == '"') {
+                    std::string_view value;
+                    if (!readString(value)) return false;
+                    accepted = handler.string(value);
+                } else if (c == '-' || (c >= '0' && c <= '9')) {
+                    std::string_view text;
+                    if (!readNumber(text)) return false;
+                    accepted = handler.number(text);
+                } else if (c == 't' || c == 'f') {
+                    if (!readLiteral(c == 't' ? "true" : "false")) return false;
+                    accepted = handler.boolean(c == 't');
+                } else if (c == 'n') {
+                    if (!readLiteral("null")) return false;
+                    accepted = handler.null();
+                } else {
+                    return fail(c < 0 ? "Unexpected end of input" : "Expected a value");
+                }
+                if (!accepted) return false;
+                state = State::AFTER_VALUE;
+                break;
+            }
+
+            case State::FIRST_KEY:
+                if (c == '}') {
+                    ++cursor;
+                    containers.pop_back();
+                    if (!handler.endObject()) return false;
+                    state = State::AFTER_VALUE;
+                    break;
+                }
+                // fall through
+            case State::KEY: {
+                if (c != '"') {
+                    return fail("Expected an object key");
+                }
+                std::string_view name;
+                if (!readString(name)) return false;
+                if (!handler.key(name)) return false;
+                if (skipWhitespace() != ':') {
+                    return fail("Expected ':' after object key");
+                }
+                ++cursor;
+                state = State::VALUE;
+                break;
+            }
+
+            case State::AFTER_VALUE:
+                if (containers.empty()) {
+                    return c < 0 || fail("Unexpected data after the document");
+                }
+                if (c == ',') {
+                    ++cursor;
+                    state = (containers.back() == '{') ? State::KEY : State::VALUE;
+                } else if (c == (containers.back() == '{' ? '}' : ']')) {
+                    ++cursor;
+                    bool object = containers.back() == '{';
+                    containers.pop_back();
+                    if (!(object ? handler.endObject() : handler.endArray())) return false;
+                } else {
+                    return fail(c < 0 ? "Unexpected end of input" : "Expected ',' or end of container");
+                }
+                break;
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#include "../include/util/LruCache.h"
+
+LruCache::LruCache(size_t budgetBytes)
+    : budget(budgetBytes), bytes(0), hits(0), misses(0), evictions(0) {}
+
+size_t LruCache::cost(const std::string& key, const std::string& value) {
+    // A list node (two links and the entry) and a table node (a link, the
+    // key view, the iterator and the cached hash) besides the strings' bytes
+    const size_t overhead = 2 * sizeof(void*) + sizeof(Entry) +
+                            sizeof(void*) + sizeof(std::string_view) +
+                            sizeof(std::list<Entry>::iterator) + sizeof(size_t);
+    return overhead + key.size() + value.size();
+}
+
+const std::string* LruCache::find(const std::string& key) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        ++misses;
+        return nullptr;
+    }
+    ++hits;
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->second;
+}
+
+void LruCache::put(const std::string& key, std::string value) {
+    auto it = index.find(key);
+    if (cost(key, value) > budget) {
+        // Keeping it would push out everything else
+        if (it != index.end()) {
+            erase(key);
+        }
+        return;
+    }
+    if (it != index.end()) {
+        Entry& entry = *it->second;
+        bytes -= cost(entry.first, entry.second);
+        entry.second = std::move(value);
+        bytes += cost(entry.first, entry.second);
+        entries.splice(entries.begin(), entries, it->second);
+    } else {
+        entries.emplace_front(key, std::move(value));
+        index.emplace(entries.front().first, entries.begin());
+        bytes += cost(entries.front().first, entries.front().second);
+    }
+    evict();
+}
+
+void LruCache::append(const std::string& key, const std::string& suffix) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return;
+    }
+    if (cost(key, it->second->second) + suffix.size() > budget) {
+        erase(key);
+        return;
+    }
+    it->second->second += suffix;
+    bytes += suffix.size();
+    entries.splice(entries.begin(), entries, it->second);
+    evict();
+}
+
+void LruCache::erase(const std::string& key) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return;
+    }
+    auto entry = it->second;
+    bytes -= cost(entry->first, entry->second);
+    index.erase(it);
+    entries.erase(entry);
+}
+
+void LruCache::setBudget(size_t budgetBytes) {
+    budget = budgetBytes;
+    evict();
+}
+
+CacheStats LruCache::stats() const {
+    CacheStats result;
+    result.entries = entries.size();
+    result.bytes = bytes;
+    result.budget = budget;
+    result.hits = hits;
+    result.misses = misses;
+    result.evictions = evictions;
+    return result;
+}
+
+void LruCache::evict() {
+    // The entry just used sits at the front and fits the budget by itself,
+    // so it is never the one evicted
+    while (bytes > budget && !entries.empty()) {
+        Entry& oldest = entries.back();
+        bytes -= cost(oldest.first, oldest.second);
+        index.erase(oldest.first);
+        entries.pop_back();
+        ++evictions;
+    }
+}
@@ -0,0 +1,70 @@
+#include "../include/storage/MappedFile.h"
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : bytes(nullptr), length(0), mapped(false) {}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char*>(bytes), length);
+    }
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path) {
+    std::shared_ptr<MappedFile> file(new MappedFile());
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    if (info.st_size > 0) {
+        void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                             MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            file->bytes = static_cast<const char*>(address);
+            file->length = static_cast<size_t>(info.st_size);
+            file->mapped = true;
+        }
+    }
+    ::close(fd);
+
+    if (file->mapped || info.st_size == 0) {
+        return file;
+    }
+#endif
+
+    // Fallback: read the whole file into the owned buffer
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return nullptr;
+    }
+    file->buffer.assign((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+    file->bytes = file->buffer.data();
+    file->length = file->buffer.size();
+    return file;
+}
+
+std::shared_ptr<MappedFile> MappedFile::fromString(std::string content) {
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->buffer = std::move(content);
+    file->bytes = file->buffer.data();
+    file->length = file->buffer.size();
+    return file;
+}
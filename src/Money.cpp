@@ -0,0 +1,148 @@
+#include "../include/models/Money.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+
+namespace {
+
+const int MAX_EXPONENT = 1000;   // far beyond any representable amount
+
+} // namespace
+
+Money Money::fromDouble(double amount) {
+    double scaled = std::round(amount * UNITS_PER_MAJOR);   // halves away from zero
+    if (!(std::fabs(scaled) < 9.2e18)) {
+        return Money();
+    }
+    return Money(static_cast<int64_t>(scaled));
+}
+
+bool Money::parse(std::string_view text, Money& value) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+        negative = (text[i] == '-');
+        ++i;
+    }
+
+    // The significant digits, leading zeros dropped, and the power of ten
+    // they are to be multiplied by
+    std::string digits;
+    int exponent = 0;
+    bool anyDigit = false;
+    bool afterPoint = false;
+    for (; i < text.size(); ++i) {
+        char c = text[i];
+        if (c >= '0' && c <= '9') {
+            anyDigit = true;
+            if (!digits.empty() || c != '0') {
+                digits += c;
+            }
+            if (afterPoint) {
+                --exponent;
+            }
+        } else if (c == '.' && !afterPoint) {
+            afterPoint = true;
+        } else {
+            break;
+        }
+    }
+    if (!anyDigit) {
+        return false;
+    }
+
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        ++i;
+        bool negativeExponent = false;
+        if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+            negativeExponent = (text[i] == '-');
+            ++i;
+        }
+        int written = 0;
+        bool anyExponentDigit = false;
+        for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+            anyExponentDigit = true;
+            written = std::min(written * 10 + (text[i] - '0'), MAX_EXPONENT);
+        }
+        if (!anyExponentDigit) {
+            return false;
+        }
+        exponent += negativeExponent ? -written : written;
+    }
+    if (i != text.size()) {
+        return false;
+    }
+    if (digits.empty()) {
+        value = Money();
+        return true;
+    }
+
+    // units = digits * 10^(exponent + SCALE), the digits past the point
+    // rounded off
+    int shift = exponent + SCALE;
+    size_t keep = digits.size();
+    bool roundUp = false;
+    if (shift < 0) {
+        size_t dropped = static_cast<size_t>(-static_cast<int64_t>(shift));
+        if (dropped > digits.size()) {
+            keep = 0;
+        } else {
+            keep = digits.size() - dropped;
+            roundUp = digits[keep] >= '5';
+        }
+        shift = 0;
+    }
+    if (keep + static_cast<size_t>(shift) > 19) {
+        return false;
+    }
+
+    uint64_t magnitude = 0;
+    for (size_t d = 0; d < keep; ++d) {
+        magnitude = magnitude * 10 + static_cast<uint64_t>(digits[d] - '0');
+    }
+    for (int s = 0; s < shift; ++s) {
+        magnitude *= 10;
+    }
+    magnitude += roundUp ? 1 : 0;
+    if (magnitude > static_cast<uint64_t>(INT64_MAX)) {
+        return false;
+    }
+
+    int64_t signedUnits = static_cast<int64_t>(magnitude);
+    value = Money(negative ? -signedUnits : signedUnits);
+    return true;
+}
+
+char* Money::toChars(char* first) const {
+    uint64_t magnitude = units < 0 ? 0 - static_cast<uint64_t>(units) : static_cast<uint64_t>(units);
+    char reversed[MAX_CHARS];
+    size_t length = 0;
+    for (int place = 0; place < SCALE; ++place) {
+        reversed[length++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    }
+    reversed[length++] = '.';
+    do {
+        reversed[length++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    if (units < 0) {
+        *first++ = '-';
+    }
+    while (length > 0) {
+        *first++ = reversed[--length];
+    }
+    return first;
+}
+
+std::string Money::toString() const {
+    char buffer[MAX_CHARS];
+    return std::string(buffer, toChars(buffer));
+}
+
+std::ostream& operator<<(std::ostream& out, Money value) {
+    char buffer[Money::MAX_CHARS];
+    return out.write(buffer, value.toChars(buffer) - buffer);
+}
@@ -0,0 +1,139 @@
+#include "../include/storage/NoteIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+
+std::vector<uint32_t> NoteIndex::trigrams(std::string_view text) {
+    std::vector<uint32_t> keys;
+    if (text.size() < 3) {
+        return keys;
+    }
+
+    keys.reserve(text.size() - 2);
+    for (size_t i = 0; i + 2 < text.size(); ++i) {
+        keys.push_back((static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16) |
+                       (static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8) |
+                       static_cast<uint32_t>(static_cast<unsigned char>(text[i + 2])));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+void NoteIndex::add(uint32_t slot, std::string_view note) {
+    for (uint32_t key : trigrams(note)) {
+        auto& list = postings[key];
+        if (list.empty() || list.back() < slot) {
+            list.push_back(slot);
+        } else {
+            auto it = std::lower_bound(list.begin(), list.end(), slot);
+            if (it == list.end() || *it != slot) {
+                list.insert(it, slot);
+            }
+        }
+    }
+}
+
+void NoteIndex::remove(uint32_t slot, std::string_view note) {
+    for (uint32_t key : trigrams(note)) {
+        auto entry = postings.find(key);
+        if (entry == postings.end()) continue;
+
+        auto& list = entry->second;
+        auto it = std::lower_bound(list.begin(), list.end(), slot);
+        if (it != list.end() && *it == slot) {
+            list.erase(it);
+        }
+        if (list.empty()) {
+            postings.erase(entry);
+        }
+    }
+}
+
+void NoteIndex::clear() {
+    postings.clear();
+}
+
+size_t NoteIndex::memoryBytes() const {
+    // Each entry is a node: next pointer, key and list
+    size_t bytes = postings.bucket_count() * sizeof(void*) +
+                   postings.size() * (sizeof(void*) + sizeof(std::pair<const uint32_t, std::vector<uint32_t>>));
+    for (const auto& entry : postings) {
+        bytes += entry.second.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+std::vector<std::string> NoteIndex::tokenize(const std::string& keyword) {
+    std::vector<std::string> terms;
+    std::string current;
+    for (char c : keyword) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            if (!current.empty()) {
+                terms.push_back(current);
+                current.clear();
+            }
+        } else {
+            current += c;
+        }
+    }
+    if (!current.empty()) {
+        terms.push_back(current);
+    }
+    return terms;
+}
+
+bool NoteIndex::isIndexable(const std::vector<std::string>& terms) const {
+    return std::any_of(terms.begin(), terms.end(),
+                       [](const std::string& term) { return term.size() >= 3; });
+}
+
+size_t NoteIndex::estimate(const std::vector<std::string>& terms) const {
+    size_t best = SIZE_MAX;
+    for (const auto& term : terms) {
+        for (uint32_t key : trigrams(term)) {
+            auto entry = postings.find(key);
+            best = std::min(best, entry == postings.end() ? size_t(0) : entry->second.size());
+        }
+    }
+    return best;
+}
+
+std::vector<uint32_t> NoteIndex::candidates(const std::vector<std::string>& terms) const {
+    std::vector<const std::vector<uint32_t>*> lists;
+    for (const auto& term : terms) {
+        for (uint32_t key : trigrams(term)) {
+            auto entry = postings.find(key);
+            if (entry == postings.end()) {
+                return {};
+            }
+            lists.push_back(&entry->second);
+        }
+    }
+    if (lists.empty()) {
+        return {};
+    }
+
+    // Intersect starting from the shortest list so the working set only shrinks
+    std::sort(lists.begin(), lists.end(),
+              [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) {
+                  return a->size() != b->size() ? a->size() < b->size() : a < b;
+              });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    std::vector<uint32_t> result = *lists[0];
+    for (size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+        const auto& list = *lists[i];
+        auto searchFrom = list.begin();
+        size_t kept = 0;
+        for (uint32_t slot : result) {
+            searchFrom = std::lower_bound(searchFrom, list.end(), slot);
+            if (searchFrom == list.end()) break;
+            if (*searchFrom == slot) {
+                result[kept++] = slot;
+            }
+        }
+        result.resize(kept);
+    }
+    return result;
+}
@@ -1,88 +1,303 @@
-#include "../include/services/NotificationService.h"
-#include "../include/storage/TransactionRepository.h"
-#include <algorithm>
-
-NotificationService::NotificationService(std::shared_ptr<TransactionRepository> repo,
-                                        std::shared_ptr<Settings> _settings)
-    : repository(repo), settings(_settings) {}
-
-NotificationService::~NotificationService() {}
-
-std::vector<Notification> NotificationService::checkThresholds() const {
-    std::vector<Notification> result;
-
-    if (!settings->monthlyBudget) {
-        return result;
-    }
-
-    // Get current month's expenses
-    time_t now = time(nullptr);
-    struct tm* timeinfo = localtime(&now);
-    timeinfo->tm_mday = 1;
-    timeinfo->tm_hour = 0;
-    timeinfo->tm_min = 0;
-    timeinfo->tm_sec = 0;
-    time_t monthStart = mktime(timeinfo);
-
-    double totalExpense = 0;
-    auto transactions = repository->getAll();
-
-    for (const auto& tx : transactions) {
-        if (tx.date >= monthStart && tx.date <= now && 
-            !tx.isDeleted && tx.type == TransactionType::EXPENSE) {
-            totalExpense += tx.amount;
-        }
-    }
-
-    double budget = settings->monthlyBudget.value();
-
-    if (totalExpense >= budget * 0.8) {
-        Notification notif("notif_budget_warning", 
-                          "You've spent 80% of your monthly budget!",
-                          "warning");
-        result.push_back(notif);
-    }
-
-    if (totalExpense >= budget) {
-        Notification notif("notif_budget_exceeded",
-                          "You've exceeded your monthly budget!",
-                          "danger");
-        result.push_back(notif);
-    }
-
-    return result;
-}
-
-void NotificationService::registerListener(NotificationListener listener) {
-    listeners.push_back(listener);
-}
-
-void NotificationService::notifyListeners(const Notification& notif) {
-    for (auto& listener : listeners) {
-        listener(notif);
-    }
-}
-
-std::vector<Notification> NotificationService::getNotifications() const {
-    return notifications;
-}
-
-void NotificationService::markAsRead(const std::string& notificationId) {
-    auto it = std::find_if(notifications.begin(), notifications.end(),
-                          [&notificationId](const Notification& n) {
-                              return n.id == notificationId;
-                          });
-
-    if (it != notifications.end()) {
-        it->isRead = true;
-    }
-}
-
-Notification NotificationService::createNotification(const std::string& message,
-                                                     const std::string& type) {
-    std::string id = "notif_" + std::to_string(time(nullptr));
-    Notification notif(id, message, type);
-    notifications.push_back(notif);
-    notifyListeners(notif);
-    return notif;
-}
+#include "../include/services/NotificationService.h"
+#include "../include/storage/TransactionRepository.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+namespace {
+
+const size_t DISPATCH_BATCH = 64;
+const time_t DEFAULT_COALESCE_WINDOW = 3600;
+
+} // namespace
+
+NotificationService::NotificationService(std::shared_ptr<TransactionRepository> repo,
+                                        std::shared_ptr<Settings> _settings)
+    : repository(repo), settings(_settings), dispatchMode(DispatchMode::SYNC), producers(0),
+      workerSleeping(false), stopping(false), pending(0), deliveredCount(0), coalescedCount(0),
+      droppedCount(0), coalesceWindow(DEFAULT_COALESCE_WINDOW), currentMonth(INT64_MIN),
+      appliedVersion(0) {
+    subscription = repository->subscribe(
+        [this](const Transaction* before, const Transaction& after, uint64_t version) {
+            onTransactionChanged(before, after, version);
+        });
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    rollOver(time(nullptr));
+}
+
+NotificationService::~NotificationService() {
+    stopWorker();
+    repository->unsubscribe(subscription);
+}
+
+void NotificationService::SpendingTotal::apply(Money amount, int sign) {
+    spent += amount * sign;
+    rows += sign;
+}
+
+void NotificationService::account(const Transaction& tx, int sign) {
+    if (tx.isDeleted || tx.type != TransactionType::EXPENSE ||
+        calendar.bucket(tx.date, Granularity::MONTH) != currentMonth) {
+        return;
+    }
+
+    monthTotal.apply(tx.amount, sign);
+    if (tx.categoryCode >= categoryTotals.size()) {
+        categoryTotals.resize(tx.categoryCode + 1);
+    }
+    categoryTotals[tx.categoryCode].apply(tx.amount, sign);
+}
+
+bool NotificationService::rollOver(time_t now) {
+    int64_t month = calendar.bucket(now, Granularity::MONTH);
+    if (month == currentMonth) {
+        return false;
+    }
+
+    currentMonth = month;
+    monthTotal = SpendingTotal();
+    categoryTotals.clear();
+
+    auto view = repository->snapshot();
+    appliedVersion = view->version();
+    view->forEachInDateRange(calendar.bucketStart(month, Granularity::MONTH),
+                             calendar.bucketStart(month + 1, Granularity::MONTH) - 1,
+                             [this](const Transaction& tx) { account(tx, 1); }, RowFields::NUMERIC);
+    return true;
+}
+
+void NotificationService::onTransactionChanged(const Transaction* before, const Transaction& after,
+                                               uint64_t version) {
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    // Observers run after the change is published, so a rebuild already has it
+    rollOver(time(nullptr));
+    if (version <= appliedVersion) {
+        return;
+    }
+    appliedVersion = version;
+    if (before) {
+        account(*before, -1);
+    }
+    account(after, 1);
+}
+
+std::vector<Notification> NotificationService::checkThresholds() {
+    std::vector<Notification> result;
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    rollOver(time(nullptr));
+
+    if (settings->monthlyBudget) {
+        Money budget = settings->monthlyBudget.value();
+
+        if (monthTotal.spent * 5 >= budget * 4) {   // 80%, in exact arithmetic
+            Notification notif("notif_budget_warning", 
+                              "You've spent 80% of your monthly budget!",
+                              "warning");
+            result.push_back(notif);
+        }
+
+        if (monthTotal.spent >= budget) {
+            Notification notif("notif_budget_exceeded",
+                              "You've exceeded your monthly budget!",
+                              "danger");
+            result.push_back(notif);
+        }
+    }
+
+    const CategoryRegistry& categories = repository->categories();
+    for (const auto& [categoryId, limit] : settings->reminderThresholds) {
+        uint32_t code = categories.find(categoryId);
+        if (code >= categoryTotals.size() || categoryTotals[code].rows == 0) continue;
+        const SpendingTotal& total = categoryTotals[code];
+
+        if (total.spent * 5 >= limit * 4) {
+            Notification notif("notif_category_warning_" + categoryId,
+                              "You've spent 80% of your budget for " + categoryId + "!",
+                              "warning");
+            result.push_back(notif);
+        }
+
+        if (total.spent >= limit) {
+            Notification notif("notif_category_exceeded_" + categoryId,
+                              "You've exceeded your budget for " + categoryId + "!",
+                              "danger");
+            result.push_back(notif);
+        }
+    }
+
+    return result;
+}
+
+void NotificationService::registerListener(NotificationListener listener) {
+    std::lock_guard<std::mutex> lock(listenersMutex);
+    listeners.push_back(listener);
+}
+
+void NotificationService::notifyListeners(const Notification& notif) {
+    std::shared_ptr<BoundedQueue<Notification>> target;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        target = queue;
+        if (target) {
+            ++producers;
+        }
+    }
+    if (!target) {
+        deliver(notif);
+        return;
+    }
+
+    // Count before publishing so the worker never takes pending below zero
+    pending.fetch_add(1);
+    if (target->tryPush(notif)) {
+        // Pairs with the fence in dispatchLoop: either this load sees the
+        // worker going to sleep, or the worker's emptiness check sees the push
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (workerSleeping.load()) {
+            std::lock_guard<std::mutex> lock(dispatchMutex);
+            wakeWorker.notify_one();
+        }
+    } else {
+        pending.fetch_sub(1);
+        droppedCount.fetch_add(1);
+    }
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (--producers == 0) {
+        producersDone.notify_all();
+    }
+}
+
+void NotificationService::deliver(const Notification& notif) {
+    std::lock_guard<std::mutex> lock(listenersMutex);
+    time_t window = coalesceWindow.load();
+    auto last = lastDelivered.find(notif.id);
+    if (window > 0 && last != lastDelivered.end() && notif.timestamp - last->second < window) {
+        coalescedCount.fetch_add(1);
+        return;
+    }
+    lastDelivered[notif.id] = notif.timestamp;
+
+    for (auto& listener : listeners) {
+        listener(notif);
+    }
+    deliveredCount.fetch_add(1);
+}
+
+void NotificationService::dispatchLoop(BoundedQueue<Notification>& queued) {
+    Notification notif;
+    for (;;) {
+        size_t batch = 0;
+        while (batch < DISPATCH_BATCH && queued.tryPop(notif)) {
+            try {
+                deliver(notif);
+            } catch (const std::exception& e) {
+                std::cerr << "Notification listener failed: " << e.what() << std::endl;
+            }
+            ++batch;
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(dispatchMutex);
+                queueDrained.notify_all();
+            }
+        }
+        if (batch > 0) {
+            continue;
+        }
+
+        // Producers check workerSleeping after publishing, and the predicate
+        // is re-checked under the mutex they notify with. The fences on both
+        // sides order each store before the other side's load, so at least
+        // one of them sees the other: no lost wake-ups
+        std::unique_lock<std::mutex> lock(dispatchMutex);
+        workerSleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wakeWorker.wait(lock, [&] { return stopping || !queued.empty(); });
+        workerSleeping.store(false);
+        if (stopping && queued.empty()) {
+            return;
+        }
+    }
+}
+
+void NotificationService::stopWorker() {
+    // New notifications are delivered on the caller's thread from here on;
+    // pushes that already hold the queue finish before the final drain
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queue.reset();
+        producersDone.wait(lock, [this] { return producers == 0; });
+    }
+    if (!worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(dispatchMutex);
+        stopping = true;
+    }
+    wakeWorker.notify_one();
+    worker.join();
+    stopping = false;
+}
+
+void NotificationService::setDispatchMode(DispatchMode mode, size_t queueCapacity) {
+    std::lock_guard<std::mutex> modeLock(modeMutex);
+    stopWorker();
+    if (mode == DispatchMode::ASYNC) {
+        auto created = std::make_shared<BoundedQueue<Notification>>(queueCapacity);
+        worker = std::thread([this, created] { dispatchLoop(*created); });
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue = created;
+    }
+    dispatchMode.store(mode);
+}
+
+void NotificationService::setCoalesceWindow(time_t seconds) {
+    coalesceWindow.store(seconds);
+}
+
+void NotificationService::flush() {
+    std::unique_lock<std::mutex> lock(dispatchMutex);
+    queueDrained.wait(lock, [this] { return pending.load() == 0; });
+}
+
+DispatchStats NotificationService::getDispatchStats() const {
+    DispatchStats stats;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stats.queueDepth = queue ? queue->size() : 0;
+    }
+    stats.delivered = deliveredCount.load();
+    stats.coalesced = coalescedCount.load();
+    stats.dropped = droppedCount.load();
+    return stats;
+}
+
+std::vector<Notification> NotificationService::getNotifications() const {
+    std::lock_guard<std::mutex> lock(notificationsMutex);
+    return notifications;
+}
+
+void NotificationService::markAsRead(const std::string& notificationId) {
+    std::lock_guard<std::mutex> lock(notificationsMutex);
+    auto it = std::find_if(notifications.begin(), notifications.end(),
+                          [&notificationId](const Notification& n) {
+                              return n.id == notificationId;
+                          });
+
+    if (it != notifications.end()) {
+        it->isRead = true;
+    }
+}
+
+Notification NotificationService::createNotification(const std::string& message,
+                                                     const std::string& type) {
+    std::string id = "notif_" + std::to_string(time(nullptr));
+    Notification notif(id, message, type);
+    {
+        std::lock_guard<std::mutex> lock(notificationsMutex);
+        notifications.push_back(notif);
+    }
+    notifyListeners(notif);
+    return notif;
+}
@@ -0,0 +1,125 @@
+#include "../include/storage/OutputSink.h"
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+OutputSink::OutputSink(const std::string& path, size_t bufferSize)
+    : target(Target::FD), ownsFd(true), stream(nullptr), text(nullptr),
+      buffer(bufferSize > 0 ? bufferSize : 1), used(0), flushedBytes(0) {
+#ifdef _WIN32
+    fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    }
+}
+
+OutputSink::OutputSink(int _fd, size_t bufferSize)
+    : target(Target::FD), fd(_fd), ownsFd(false), stream(nullptr), text(nullptr),
+      buffer(bufferSize > 0 ? bufferSize : 1), used(0), flushedBytes(0) {}
+
+OutputSink::OutputSink(std::ostream& out, size_t bufferSize)
+    : target(Target::STREAM), fd(-1), ownsFd(false), stream(&out), text(nullptr),
+      buffer(bufferSize > 0 ? bufferSize : 1), used(0), flushedBytes(0) {}
+
+OutputSink::OutputSink(std::string* out, size_t bufferSize)
+    : target(Target::STRING), fd(-1), ownsFd(false), stream(nullptr), text(out),
+      buffer(bufferSize > 0 ? bufferSize : 1), used(0), flushedBytes(0) {}
+
+OutputSink::~OutputSink() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Reported to callers that flush() explicitly
+    }
+    if (ownsFd) {
+#ifdef _WIN32
+        _close(fd);
+#else
+        ::close(fd);
+#endif
+    }
+}
+
+void OutputSink::write(const char* data, size_t size) {
+    if (size <= buffer.size() - used) {
+        std::memcpy(buffer.data() + used, data, size);
+        used += size;
+        return;
+    }
+
+    drain();
+    if (size >= buffer.size()) {
+        // Large blocks go straight through instead of being copied in pieces
+        emit(data, size);
+        return;
+    }
+    std::memcpy(buffer.data(), data, size);
+    used = size;
+}
+
+void OutputSink::writeInt(int64_t value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    write(digits, static_cast<size_t>(result.ptr - digits));
+}
+
+void OutputSink::writeMoney(Money value) {
+    char digits[Money::MAX_CHARS];
+    write(digits, static_cast<size_t>(value.toChars(digits) - digits));
+}
+
+void OutputSink::drain() {
+    emit(buffer.data(), used);
+    used = 0;
+}
+
+void OutputSink::emit(const char* data, size_t size) {
+    flushedBytes += size;
+
+    switch (target) {
+        case Target::FD:
+            while (size > 0) {
+#ifdef _WIN32
+                int written = _write(fd, data, static_cast<unsigned int>(size));
+#else
+                ssize_t written = ::write(fd, data, size);
+#endif
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error(std::string("Write failed: ") + std::strerror(errno));
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+            break;
+        case Target::STREAM:
+            stream->write(data, static_cast<std::streamsize>(size));
+            if (!*stream) {
+                throw std::runtime_error("Write failed: output stream is in a failed state");
+            }
+            break;
+        case Target::STRING:
+            text->append(data, size);
+            break;
+    }
+}
+
+void OutputSink::flush() {
+    drain();
+    if (target == Target::STREAM) {
+        stream->flush();
+    }
+}
@@ -1,106 +1,430 @@
-#include "../include/services/StatisticsService.h"
-#include "../include/storage/TransactionRepository.h"
-#include <ctime>
-#include <iomanip>
-#include <sstream>
-#include <cmath>
-
-StatisticsService::StatisticsService(std::shared_ptr<TransactionRepository> repo)
-    : repository(repo) {}
-
-StatisticsService::~StatisticsService() {}
-
-std::string StatisticsService::getMonthKey(time_t timestamp) const {
-    struct tm* timeinfo = localtime(&timestamp);
-    std::stringstream ss;
-    ss << std::put_time(timeinfo, "%Y-%m");
-    return ss.str();
-}
-
-bool StatisticsService::isInDateRange(time_t date, const DateRange& range) const {
-    return (range.from == 0 || date >= range.from) &&
-           (range.to == 0 || date <= range.to);
-}
-
-std::map<std::string, double> StatisticsService::calculateMonthlyTotals(const DateRange& range) const {
-    std::map<std::string, double> result;
-    auto transactions = repository->getAll();
-
-    for (const auto& tx : transactions) {
-        if (isInDateRange(tx.date, range) && !tx.isDeleted) {
-            std::string month = getMonthKey(tx.date);
-            if (result.find(month) == result.end()) {
-                result[month] = 0;
-            }
-
-            if (tx.type == TransactionType::INCOME) {
-                result[month] += tx.amount;
-            } else {
-                result[month] -= tx.amount;
-            }
-        }
-    }
-
-    return result;
-}
-
-std::map<std::string, double> StatisticsService::categoryBreakdown(const DateRange& range) const {
-    std::map<std::string, double> result;
-    auto transactions = repository->getAll();
-
-    for (const auto& tx : transactions) {
-        if (isInDateRange(tx.date, range) && !tx.isDeleted && tx.type == TransactionType::EXPENSE) {
-            if (result.find(tx.categoryId) == result.end()) {
-                result[tx.categoryId] = 0;
-            }
-            result[tx.categoryId] += tx.amount;
-        }
-    }
-
-    return result;
-}
-
-std::map<time_t, double> StatisticsService::assetTrend(const DateRange& range) const {
-    std::map<time_t, double> result;
-    auto transactions = repository->getAll();
-
-    double currentBalance = 0;
-    for (const auto& tx : transactions) {
-        if (isInDateRange(tx.date, range) && !tx.isDeleted) {
-            if (tx.type == TransactionType::INCOME) {
-                currentBalance += tx.amount;
-            } else {
-                currentBalance -= tx.amount;
-            }
-            result[tx.date] = currentBalance;
-        }
-    }
-
-    return result;
-}
-
-double StatisticsService::getTotalIncome(const DateRange& range) const {
-    double total = 0;
-    auto transactions = repository->getAll();
-
-    for (const auto& tx : transactions) {
-        if (isInDateRange(tx.date, range) && !tx.isDeleted && tx.type == TransactionType::INCOME) {
-            total += tx.amount;
-        }
-    }
-
-    return total;
-}
-
-double StatisticsService::getTotalExpense(const DateRange& range) const {
-    double total = 0;
-    auto transactions = repository->getAll();
-
-    for (const auto& tx : transactions) {
-        if (isInDateRange(tx.date, range) && !tx.isDeleted && tx.type == TransactionType::EXPENSE) {
-            total += tx.amount;
-        }
-    }
-
-    return total;
-}
+#include "../include/services/StatisticsService.h"
+#include "../include/storage/TransactionRepository.h"
+#include "../include/util/ThreadPool.h"
+#include <algorithm>
+#include <ctime>
+#include <cmath>
+
+StatisticsService::StatisticsService(std::shared_ptr<TransactionRepository> repo, size_t threads)
+    : repository(repo), appliedVersion(0) {
+    setThreadCount(threads);
+    // Subscribing first means no change can fall between the rebuild's view
+    // and the first delta; deltas the view already includes are skipped
+    subscription = repository->subscribe(
+        [this](const Transaction* before, const Transaction& after, uint64_t version) {
+            onTransactionChanged(before, after, version);
+        });
+    rebuildAggregates();
+}
+
+StatisticsService::~StatisticsService() {
+    repository->unsubscribe(subscription);
+}
+
+void StatisticsService::setThreadCount(size_t threads) {
+    pool.reset(threads > 1 ? new ThreadPool(threads) : nullptr);
+}
+
+size_t StatisticsService::getThreadCount() const {
+    return pool ? pool->size() : 1;
+}
+
+ThreadPool* StatisticsService::poolFor(ExecutionMode mode) const {
+    return mode == ExecutionMode::PARALLEL ? pool.get() : nullptr;
+}
+
+void StatisticsService::Aggregate::apply(const Transaction& tx, int sign) {
+    if (tx.type == TransactionType::INCOME) {
+        income += tx.amount * sign;
+        incomeCount += sign;
+    } else {
+        expense += tx.amount * sign;
+        expenseCount += sign;
+    }
+}
+
+void StatisticsService::Aggregate::merge(const Aggregate& other) {
+    income += other.income;
+    expense += other.expense;
+    incomeCount += other.incomeCount;
+    expenseCount += other.expenseCount;
+}
+
+int64_t StatisticsService::monthIndex(time_t timestamp) const {
+    return calendar.bucket(timestamp, Granularity::MONTH);
+}
+
+time_t StatisticsService::monthStart(int64_t month) const {
+    return calendar.bucketStart(month, Granularity::MONTH);
+}
+
+bool StatisticsService::isInDateRange(time_t date, const DateRange& range) const {
+    return (range.from == 0 || date >= range.from) &&
+           (range.to == 0 || date <= range.to);
+}
+
+void StatisticsService::rebuildAggregates() {
+    struct Partial {
+        std::map<int64_t, Aggregate> months;
+        std::map<int64_t, std::vector<Aggregate>> monthCategories;
+    };
+
+    std::lock_guard<std::mutex> lock(mutex);
+    view = repository->snapshot();
+    appliedVersion = view->version();
+
+    std::vector<Partial> partials(view->partitionCount());
+    ThreadPool::run(pool.get(), partials.size(), [&](size_t partition) {
+        Partial& partial = partials[partition];
+        view->forEachInPartition(partition, [&](const Transaction& tx) {
+            int64_t month = monthIndex(tx.date);
+            partial.months[month].apply(tx, 1);
+            auto& categories = partial.monthCategories[month];
+            if (categories.empty()) {
+                categories.resize(view->categoryCount());
+            }
+            categories[tx.categoryCode].apply(tx, 1);
+        }, RowFields::NUMERIC);
+    });
+
+    monthAggregates.clear();
+    monthCategoryAggregates.clear();
+    for (const auto& partial : partials) {
+        for (const auto& [month, aggregate] : partial.months) {
+            monthAggregates[month].merge(aggregate);
+        }
+        for (const auto& [month, categories] : partial.monthCategories) {
+            auto& merged = monthCategoryAggregates[month];
+            merged.resize(std::max(merged.size(), categories.size()));
+            for (size_t code = 0; code < categories.size(); ++code) {
+                merged[code].merge(categories[code]);
+            }
+        }
+    }
+}
+
+void StatisticsService::accumulate(const Transaction& tx, int sign) {
+    int64_t month = monthIndex(tx.date);
+
+    auto& categories = monthCategoryAggregates[month];
+    if (tx.categoryCode >= categories.size()) {
+        categories.resize(tx.categoryCode + 1);
+    }
+    categories[tx.categoryCode].apply(tx, sign);
+
+    auto& aggregate = monthAggregates[month];
+    aggregate.apply(tx, sign);
+    if (aggregate.empty()) {
+        // Every category of an empty month is empty too
+        monthAggregates.erase(month);
+        monthCategoryAggregates.erase(month);
+    }
+}
+
+void StatisticsService::onTransactionChanged(const Transaction* before, const Transaction& after,
+                                             uint64_t version) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (version <= appliedVersion) {
+        return;   // already counted by the rebuild
+    }
+
+    if (before && !before->isDeleted) {
+        accumulate(*before, -1);
+    }
+    if (!after.isDeleted) {
+        accumulate(after, 1);
+    }
+    appliedVersion = version;
+
+    // Observers run before the next write can publish, so the latest view
+    // is this change's, or the end of the bulk insert it belongs to
+    auto latest = repository->snapshot();
+    if (latest->version() == version) {
+        view = std::move(latest);
+        settled.notify_all();
+    }
+}
+
+std::shared_ptr<const TransactionView> StatisticsService::settledView(std::unique_lock<std::mutex>& lock) const {
+    settled.wait(lock, [this] { return view->version() == appliedVersion; });
+    return view;
+}
+
+StatisticsService::RangePlan StatisticsService::planRange(const DateRange& range) const {
+    RangePlan plan{1, 0, {}};
+    if (monthAggregates.empty() || (range.from != 0 && range.to != 0 && range.from > range.to)) {
+        return plan;
+    }
+
+    // Whole months inside the range come from the cache...
+    int64_t first = (range.from == 0) ? monthAggregates.begin()->first : monthIndex(range.from);
+    if (range.from != 0 && monthStart(first) != range.from) {
+        ++first;
+    }
+    int64_t last = (range.to == 0) ? monthAggregates.rbegin()->first : monthIndex(range.to);
+    if (range.to != 0 && monthStart(last + 1) - 1 != range.to) {
+        --last;
+    }
+
+    if (first > last) {
+        // No whole month inside: the range spans at most two partial months
+        if (range.from != 0 && range.to != 0 && monthIndex(range.from) != monthIndex(range.to)) {
+            time_t split = monthStart(monthIndex(range.to));
+            plan.edges.push_back({{range.from, split - 1}, monthIndex(range.from)});
+            plan.edges.push_back({{split, range.to}, monthIndex(range.to)});
+        } else {
+            plan.edges.push_back({range, monthIndex(range.from != 0 ? range.from : range.to)});
+        }
+        return plan;
+    }
+
+    // ...and only the partial months at either end are scanned
+    plan.firstMonth = first;
+    plan.lastMonth = last;
+    if (range.from != 0 && range.from < monthStart(first)) {
+        plan.edges.push_back({{range.from, monthStart(first) - 1}, first - 1});
+    }
+    if (range.to != 0 && range.to > monthStart(last + 1) - 1) {
+        plan.edges.push_back({{monthStart(last + 1), range.to}, last + 1});
+    }
+    return plan;
+}
+
+std::map<int64_t, Money> StatisticsService::scanTotals(const TransactionView& snapshot,
+                                                      const DateRange& range, Granularity granularity,
+                                                      ExecutionMode mode) const {
+    std::vector<std::map<int64_t, Money>> partials(snapshot.partitionCount());
+    ThreadPool::run(poolFor(mode), partials.size(), [&](size_t partition) {
+        auto& partial = partials[partition];
+        snapshot.forEachInPartition(partition, [&](const Transaction& tx) {
+            if (isInDateRange(tx.date, range)) {
+                Money& total = partial[calendar.bucket(tx.date, granularity)];
+                total += (tx.type == TransactionType::INCOME) ? tx.amount : -tx.amount;
+            }
+        }, RowFields::NUMERIC);
+    });
+
+    std::map<int64_t, Money> buckets;
+    for (const auto& partial : partials) {
+        for (const auto& [bucket, total] : partial) {
+            buckets[bucket] += total;
+        }
+    }
+    return buckets;
+}
+
+std::map<std::string, Money> StatisticsService::calculateMonthlyTotals(const DateRange& range,
+                                                                      Granularity granularity,
+                                                                      ExecutionMode mode) const {
+    std::map<int64_t, Money> buckets;
+    std::unique_lock<std::mutex> lock(mutex);
+    auto snapshot = settledView(lock);
+
+    if (granularity == Granularity::DAY || granularity == Granularity::WEEK) {
+        // Finer than the cache (and weeks straddle months): scan
+        lock.unlock();
+        buckets = scanTotals(*snapshot, range, granularity, mode);
+    } else {
+        // Months, quarters and years are unions of cached months
+        RangePlan plan = planRange(range);
+
+        if (plan.hasMonths()) {
+            auto end = monthAggregates.upper_bound(plan.lastMonth);
+            for (auto it = monthAggregates.lower_bound(plan.firstMonth); it != end; ++it) {
+                buckets[CalendarBucketer::fromMonth(it->first, granularity)] +=
+                    it->second.income - it->second.expense;
+            }
+        }
+        lock.unlock();
+
+        for (const auto& edge : plan.edges) {
+            ColumnSum income = snapshot->sumAmounts(edge.range.from, edge.range.to,
+                                                    TransactionType::INCOME, poolFor(mode));
+            ColumnSum expense = snapshot->sumAmounts(edge.range.from, edge.range.to,
+                                                     TransactionType::EXPENSE, poolFor(mode));
+            if (income.count + expense.count > 0) {
+                buckets[CalendarBucketer::fromMonth(edge.month, granularity)] += income.sum - expense.sum;
+            }
+        }
+    }
+
+    // Labels are zero-padded, so they sort in the same order as the ids
+    std::map<std::string, Money> result;
+    for (const auto& [bucket, total] : buckets) {
+        result.emplace_hint(result.end(), calendar.label(bucket, granularity), total);
+    }
+    return result;
+}
+
+std::vector<ColumnSum> StatisticsService::expensesByCategoryCode(
+    const DateRange& range, ExecutionMode mode, std::shared_ptr<const TransactionView>& snapshot) const {
+    std::unique_lock<std::mutex> lock(mutex);
+    snapshot = settledView(lock);
+    RangePlan plan = planRange(range);
+
+    // Every code the cache holds was assigned before the settled view was
+    // published, so the view can name them all
+    std::vector<ColumnSum> byCode(snapshot->categoryCount());
+    if (plan.hasMonths()) {
+        auto end = monthCategoryAggregates.upper_bound(plan.lastMonth);
+        for (auto it = monthCategoryAggregates.lower_bound(plan.firstMonth); it != end; ++it) {
+            for (size_t code = 0; code < it->second.size(); ++code) {
+                const Aggregate& aggregate = it->second[code];
+                if (aggregate.expenseCount > 0) {
+                    byCode[code].sum += aggregate.expense;
+                    byCode[code].count += aggregate.expenseCount;
+                }
+            }
+        }
+    }
+    lock.unlock();
+
+    for (const auto& edge : plan.edges) {
+        auto sums = snapshot->sumByCategoryCode(edge.range.from, edge.range.to,
+                                                TransactionType::EXPENSE, poolFor(mode));
+        for (size_t code = 0; code < sums.size(); ++code) {
+            byCode[code].sum += sums[code].sum;
+            byCode[code].count += sums[code].count;
+        }
+    }
+
+    return byCode;
+}
+
+std::map<std::string, Money> StatisticsService::categoryBreakdown(const DateRange& range,
+                                                                 ExecutionMode mode) const {
+    std::shared_ptr<const TransactionView> snapshot;
+    std::vector<ColumnSum> byCode = expensesByCategoryCode(range, mode, snapshot);
+
+    // Category ids only appear here, at the edge of the service
+    std::map<std::string, Money> result;
+    for (uint32_t code = 0; code < byCode.size(); ++code) {
+        if (byCode[code].count > 0) {
+            result.emplace(snapshot->categoryId(code), byCode[code].sum);
+        }
+    }
+    return result;
+}
+
+std::map<std::string, CategoryRollup> StatisticsService::categoryTreeBreakdown(const DateRange& range,
+                                                                             ExecutionMode mode) const {
+    std::shared_ptr<const TransactionView> snapshot;
+    std::vector<ColumnSum> own = expensesByCategoryCode(range, mode, snapshot);
+
+    // Taken after the view, so the tree and the id table cover every code
+    // the view's rows carry; codes interned since then have no rows in it
+    const CategoryRegistry& categories = repository->categories();
+    auto tree = categories.tree();
+    auto ids = categories.ids();
+    own.resize(tree->parents.size());
+
+    std::vector<ColumnSum> subtree = own;
+    for (uint32_t code : tree->postOrder) {
+        uint32_t parent = tree->parents[code];
+        if (parent != CategoryRegistry::NONE) {
+            subtree[parent].sum += subtree[code].sum;
+            subtree[parent].count += subtree[code].count;
+        }
+    }
+
+    // A non-empty subtree makes its parent's non-empty too, so every
+    // reported category's parent is reported as well
+    std::map<std::string, CategoryRollup> result;
+    for (uint32_t code = 0; code < subtree.size(); ++code) {
+        if (subtree[code].count == 0) continue;
+        CategoryRollup& rollup = result[(*ids)[code]];
+        rollup.own = own[code].sum;
+        rollup.total = subtree[code].sum;
+        uint32_t parent = tree->parents[code];
+        if (parent != CategoryRegistry::NONE) {
+            rollup.parentId = (*ids)[parent];
+            result[(*ids)[parent]].children.push_back((*ids)[code]);
+        }
+    }
+    return result;
+}
+
+std::map<time_t, Money> StatisticsService::assetTrend(const DateRange& range, ExecutionMode mode) const {
+    // Each partition records its running balance from zero; adding the
+    // totals of the partitions before it turns that into the ledger balance
+    struct Partial {
+        std::map<time_t, Money> balances;
+        Money net;
+    };
+
+    std::shared_ptr<const TransactionView> snapshot;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        snapshot = settledView(lock);
+    }
+
+    std::vector<Partial> partials(snapshot->partitionCount());
+    ThreadPool::run(poolFor(mode), partials.size(), [&](size_t partition) {
+        Partial& partial = partials[partition];
+        snapshot->forEachInPartition(partition, [&](const Transaction& tx) {
+            if (isInDateRange(tx.date, range)) {
+                if (tx.type == TransactionType::INCOME) {
+                    partial.net += tx.amount;
+                } else {
+                    partial.net -= tx.amount;
+                }
+                partial.balances[tx.date] = partial.net;
+            }
+        }, RowFields::NUMERIC);
+    });
+
+    std::map<time_t, Money> result;
+    Money openingBalance;
+    for (const auto& partial : partials) {
+        for (const auto& [date, balance] : partial.balances) {
+            result[date] = openingBalance + balance;
+        }
+        openingBalance += partial.net;
+    }
+
+    return result;
+}
+
+Money StatisticsService::getTotalIncome(const DateRange& range, ExecutionMode mode) const {
+    Money total;
+    std::unique_lock<std::mutex> lock(mutex);
+    auto snapshot = settledView(lock);
+    RangePlan plan = planRange(range);
+
+    if (plan.hasMonths()) {
+        auto end = monthAggregates.upper_bound(plan.lastMonth);
+        for (auto it = monthAggregates.lower_bound(plan.firstMonth); it != end; ++it) {
+            total += it->second.income;
+        }
+    }
+    lock.unlock();
+
+    for (const auto& edge : plan.edges) {
+        total += snapshot->sumAmounts(edge.range.from, edge.range.to,
+                                      TransactionType::INCOME, poolFor(mode)).sum;
+    }
+
+    return total;
+}
+
+Money StatisticsService::getTotalExpense(const DateRange& range, ExecutionMode mode) const {
+    Money total;
+    std::unique_lock<std::mutex> lock(mutex);
+    auto snapshot = settledView(lock);
+    RangePlan plan = planRange(range);
+
+    if (plan.hasMonths()) {
+        auto end = monthAggregates.upper_bound(plan.lastMonth);
+        for (auto it = monthAggregates.lower_bound(plan.firstMonth); it != end; ++it) {
+            total += it->second.expense;
+        }
+    }
+    lock.unlock();
+
+    for (const auto& edge : plan.edges) {
+        total += snapshot->sumAmounts(edge.range.from, edge.range.to,
+                                      TransactionType::EXPENSE, poolFor(mode)).sum;
+    }
+
+    return total;
+}
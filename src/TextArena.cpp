@@ -0,0 +1,31 @@
+#include "../include/storage/TextArena.h"
+
+TextArena::TextArena() : cursor(nullptr), remaining(0), used(0), reserved(0) {}
+
+std::string_view TextArena::store(std::string_view text) {
+    if (text.empty()) {
+        return std::string_view();
+    }
+
+    char* target;
+    if (text.size() > BLOCK_BYTES / 4) {
+        // Large text gets an exact block, leaving the current one to fill
+        blocks.push_back(std::make_unique<char[]>(text.size()));
+        reserved += text.size();
+        target = blocks.back().get();
+    } else {
+        if (text.size() > remaining) {
+            blocks.push_back(std::make_unique<char[]>(BLOCK_BYTES));
+            reserved += BLOCK_BYTES;
+            cursor = blocks.back().get();
+            remaining = BLOCK_BYTES;
+        }
+        target = cursor;
+        cursor += text.size();
+        remaining -= text.size();
+    }
+
+    std::memcpy(target, text.data(), text.size());
+    used += text.size();
+    return std::string_view(target, text.size());
+}
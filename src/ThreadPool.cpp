@@ -0,0 +1,97 @@
+#include "../include/util/ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threads) : stopping(false) {
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::hardwareThreads() {
+    unsigned int threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+void ThreadPool::workerLoop() {
+    std::shared_ptr<Job> current;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || (job && job != current); });
+            if (stopping) {
+                return;
+            }
+            current = job;
+        }
+        // A worker that wakes late finds every index taken and drains nothing
+        drain(*current);
+    }
+}
+
+void ThreadPool::drain(Job& current) {
+    for (size_t index; (index = current.next.fetch_add(1)) < current.count;) {
+        try {
+            (*current.task)(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(current.errorMutex);
+            if (!current.error) {
+                current.error = std::current_exception();
+            }
+        }
+        if (current.completed.fetch_add(1) + 1 == current.count) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> running(runMutex);
+    auto current = std::make_shared<Job>();
+    current->task = &task;
+    current->count = count;
+
+    if (!workers.empty() && count > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = current;
+        }
+        wake.notify_all();
+    }
+
+    drain(*current);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return current->completed.load() == current->count; });
+        job.reset();
+    }
+
+    if (current->error) {
+        std::rethrow_exception(current->error);
+    }
+}
+
+void ThreadPool::run(ThreadPool* pool, size_t count, const std::function<void(size_t)>& task) {
+    if (pool) {
+        pool->parallelFor(count, task);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        task(i);
+    }
+}
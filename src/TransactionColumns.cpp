@@ -0,0 +1,159 @@
+#include "../include/storage/TransactionColumns.h"
+#include <atomic>
+#include <cstring>
+#include <limits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSACTION_COLUMNS_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+std::atomic<bool> scalarOnly(false);
+
+struct KernelArgs {
+    const int64_t* amounts;
+    const int64_t* dates;
+    const uint8_t* types;
+    const uint8_t* deletedFlags;
+    size_t begin;
+    size_t end;
+    int64_t from;
+    int64_t to;
+    uint8_t type;
+};
+
+bool rowMatches(const KernelArgs& args, size_t i) {
+    return args.dates[i] >= args.from && args.dates[i] <= args.to &&
+           args.types[i] == args.type && args.deletedFlags[i] == 0;
+}
+
+ColumnSum sumScalar(const KernelArgs& args) {
+    int64_t sum = 0;
+    ColumnSum result;
+    for (size_t i = args.begin; i < args.end; ++i) {
+        bool hit = rowMatches(args, i);
+        sum += hit ? args.amounts[i] : 0;
+        result.count += hit;
+    }
+    result.sum = Money::fromMinor(sum);
+    return result;
+}
+
+#ifdef TRANSACTION_COLUMNS_AVX2
+__attribute__((target("avx2")))
+__m256i widenBytes(const uint8_t* bytes) {
+    int32_t packed;
+    std::memcpy(&packed, bytes, sizeof(packed));
+    return _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(packed));
+}
+
+__attribute__((target("avx2")))
+ColumnSum sumAvx2(const KernelArgs& args) {
+    const __m256i from = _mm256_set1_epi64x(args.from);
+    const __m256i to = _mm256_set1_epi64x(args.to);
+    const __m256i type = _mm256_set1_epi64x(args.type);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sums = _mm256_setzero_si256();
+    __m256i counts = _mm256_setzero_si256();
+
+    size_t vectorEnd = args.begin + ((args.end - args.begin) & ~static_cast<size_t>(3));
+    for (size_t i = args.begin; i < vectorEnd; i += 4) {
+        __m256i dates = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(args.dates + i));
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(from, dates),
+                                          _mm256_cmpgt_epi64(dates, to));
+        __m256i wanted = _mm256_and_si256(_mm256_cmpeq_epi64(widenBytes(args.types + i), type),
+                                          _mm256_cmpeq_epi64(widenBytes(args.deletedFlags + i), zero));
+        __m256i mask = _mm256_andnot_si256(outside, wanted);
+
+        __m256i amounts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(args.amounts + i));
+        sums = _mm256_add_epi64(sums, _mm256_and_si256(amounts, mask));
+        counts = _mm256_sub_epi64(counts, mask);   // matching lanes are all ones (-1)
+    }
+
+    int64_t laneSums[4];
+    int64_t laneCounts[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(laneSums), sums);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(laneCounts), counts);
+
+    int64_t sum = laneSums[0] + laneSums[1] + laneSums[2] + laneSums[3];
+    ColumnSum result;
+    result.count = static_cast<size_t>(laneCounts[0] + laneCounts[1] + laneCounts[2] + laneCounts[3]);
+    for (size_t i = vectorEnd; i < args.end; ++i) {
+        bool hit = rowMatches(args, i);
+        sum += hit ? args.amounts[i] : 0;
+        result.count += hit;
+    }
+    result.sum = Money::fromMinor(sum);
+    return result;
+}
+
+bool useAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported && !scalarOnly.load(std::memory_order_relaxed);
+}
+#endif
+
+} // namespace
+
+TransactionColumns::TransactionColumns(size_t capacity)
+    : amounts(capacity), dates(capacity), types(capacity), deletedFlags(capacity),
+      categoryCodes(capacity) {}
+
+void TransactionColumns::set(size_t slot, const Transaction& tx, uint32_t categoryCode) {
+    amounts[slot] = tx.amount.minorUnits();
+    dates[slot] = static_cast<int64_t>(tx.date);
+    types[slot] = static_cast<uint8_t>(tx.type);
+    deletedFlags[slot] = tx.isDeleted ? 1 : 0;
+    categoryCodes[slot] = categoryCode;
+}
+
+size_t TransactionColumns::memoryBytes() const {
+    return amounts.capacity() * sizeof(int64_t) + dates.capacity() * sizeof(int64_t) +
+           types.capacity() + deletedFlags.capacity() + categoryCodes.capacity() * sizeof(uint32_t);
+}
+
+ColumnSum TransactionColumns::sumAmounts(time_t from, time_t to, TransactionType type,
+                                         size_t begin, size_t end) const {
+    KernelArgs args{amounts.data(), dates.data(), types.data(), deletedFlags.data(), begin, end,
+                    from == 0 ? std::numeric_limits<int64_t>::min() : static_cast<int64_t>(from),
+                    to == 0 ? std::numeric_limits<int64_t>::max() : static_cast<int64_t>(to),
+                    static_cast<uint8_t>(type)};
+
+#ifdef TRANSACTION_COLUMNS_AVX2
+    if (useAvx2()) {
+        return sumAvx2(args);
+    }
+#endif
+    return sumScalar(args);
+}
+
+void TransactionColumns::sumByCategory(time_t from, time_t to, TransactionType type,
+                                       size_t begin, size_t end, std::vector<ColumnSum>& byCode) const {
+    KernelArgs args{amounts.data(), dates.data(), types.data(), deletedFlags.data(), begin, end,
+                    from == 0 ? std::numeric_limits<int64_t>::min() : static_cast<int64_t>(from),
+                    to == 0 ? std::numeric_limits<int64_t>::max() : static_cast<int64_t>(to),
+                    static_cast<uint8_t>(type)};
+
+    for (size_t i = args.begin; i < args.end; ++i) {
+        if (rowMatches(args, i)) {
+            ColumnSum& bucket = byCode[categoryCodes[i]];
+            bucket.sum += Money::fromMinor(args.amounts[i]);
+            ++bucket.count;
+        }
+    }
+}
+
+const char* TransactionColumns::kernelName() {
+#ifdef TRANSACTION_COLUMNS_AVX2
+    if (useAvx2()) {
+        return "avx2";
+    }
+#endif
+    return "scalar";
+}
+
+void TransactionColumns::setScalarOnly(bool enabled) {
+    scalarOnly.store(enabled, std::memory_order_relaxed);
+}
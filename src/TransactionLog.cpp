@@ -0,0 +1,251 @@
+#include "../include/storage/TransactionLog.h"
+#include <charconv>
+#include <vector>
+
+namespace {
+
+const char FIELD_SEPARATOR = '|';
+const size_t ROW_FIELD_COUNT = 9;
+
+void appendEscaped(std::string& out, const std::string& value) {
+    for (char c : value) {
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '|':  out += "\\p"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            default:   out += c;
+        }
+    }
+}
+
+template <typename T>
+void appendNumber(std::string& out, T value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+template <typename T>
+bool parseNumber(const std::string& text, T& value) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+// Splits on unescaped separators and unescapes each field.
+std::vector<std::string> splitFields(const char* begin, const char* end) {
+    std::vector<std::string> fields(1);
+    for (const char* p = begin; p != end; ++p) {
+        if (*p == FIELD_SEPARATOR) {
+            fields.emplace_back();
+        } else if (*p == '\\' && p + 1 != end) {
+            ++p;
+            switch (*p) {
+                case 'p': fields.back() += '|'; break;
+                case 'n': fields.back() += '\n'; break;
+                case 'r': fields.back() += '\r'; break;
+                default:  fields.back() += *p;
+            }
+        } else {
+            fields.back() += *p;
+        }
+    }
+    return fields;
+}
+
+bool decodeFields(const std::vector<std::string>& fields, size_t first, Transaction& tx) {
+    if (fields.size() - first != ROW_FIELD_COUNT) {
+        return false;
+    }
+
+    int type = 0;
+    int64_t date = 0, createdAt = 0, updatedAt = 0;
+    tx.id = fields[first];
+    tx.categoryId = fields[first + 4];
+    tx.note = fields[first + 5];
+    if (!Money::parse(fields[first + 1], tx.amount) ||
+        !parseNumber(fields[first + 2], type) ||
+        !parseNumber(fields[first + 3], date) ||
+        !parseNumber(fields[first + 6], createdAt) ||
+        !parseNumber(fields[first + 7], updatedAt)) {
+        return false;
+    }
+
+    tx.type = (type == static_cast<int>(TransactionType::INCOME))
+                  ? TransactionType::INCOME : TransactionType::EXPENSE;
+    tx.date = static_cast<time_t>(date);
+    tx.createdAt = static_cast<time_t>(createdAt);
+    tx.updatedAt = static_cast<time_t>(updatedAt);
+    tx.isDeleted = (fields[first + 8] == "1");
+    return true;
+}
+
+std::string seal(std::string body) {
+    char buffer[9];
+    uint32_t crc = TransactionLog::crc32(body.data(), body.size());
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), crc, 16);
+    body += FIELD_SEPARATOR;
+    body.append(buffer, result.ptr);
+    body += '\n';
+    return body;
+}
+
+bool isRowRecord(LogOp op) {
+    return op == LogOp::ADD || op == LogOp::UPDATE || op == LogOp::REMOVE;
+}
+
+// Parses the record starting at offset. Returns the offset just past it, or
+// npos if it is incomplete or corrupted. The number carried by a GENERATION
+// or BATCH record is stored in number (and in record.generation).
+size_t parseRecord(std::string_view log, size_t offset, LogRecord& record, uint64_t& number) {
+    size_t lineEnd = log.find('\n', offset);
+    if (lineEnd == std::string_view::npos) {
+        return std::string_view::npos;  // torn tail: the last append never completed
+    }
+
+    size_t crcStart = log.rfind(FIELD_SEPARATOR, lineEnd);
+    if (crcStart == std::string_view::npos || crcStart <= offset) {
+        return std::string_view::npos;
+    }
+
+    uint32_t storedCrc = 0;
+    const char* crcEnd = log.data() + lineEnd;
+    auto parsed = std::from_chars(log.data() + crcStart + 1, crcEnd, storedCrc, 16);
+    if (parsed.ec != std::errc() || parsed.ptr != crcEnd ||
+        storedCrc != TransactionLog::crc32(log.data() + offset, crcStart - offset)) {
+        return std::string_view::npos;
+    }
+
+    auto fields = splitFields(log.data() + offset, log.data() + crcStart);
+    if (fields[0].size() != 1) {
+        return std::string_view::npos;
+    }
+
+    record.op = static_cast<LogOp>(fields[0][0]);
+    if (record.op == LogOp::GENERATION || record.op == LogOp::BATCH) {
+        if (fields.size() != 2 || !parseNumber(fields[1], number)) {
+            return std::string_view::npos;
+        }
+        record.generation = number;
+    } else if (isRowRecord(record.op)) {
+        if (!decodeFields(fields, 1, record.tx)) {
+            return std::string_view::npos;
+        }
+    } else {
+        return std::string_view::npos;
+    }
+    return lineEnd + 1;
+}
+
+} // namespace
+
+uint32_t TransactionLog::crc32(const char* data, size_t length) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+std::string TransactionLog::encodeRow(const Transaction& tx) {
+    std::string out;
+    out.reserve(64 + tx.id.size() + tx.categoryId.size() + tx.note.size());
+    appendEscaped(out, tx.id);
+    out += FIELD_SEPARATOR;
+    char amount[Money::MAX_CHARS];
+    out.append(amount, tx.amount.toChars(amount));
+    out += FIELD_SEPARATOR;
+    appendNumber(out, static_cast<int>(tx.type));
+    out += FIELD_SEPARATOR;
+    appendNumber(out, static_cast<int64_t>(tx.date));
+    out += FIELD_SEPARATOR;
+    appendEscaped(out, tx.categoryId);
+    out += FIELD_SEPARATOR;
+    appendEscaped(out, tx.note);
+    out += FIELD_SEPARATOR;
+    appendNumber(out, static_cast<int64_t>(tx.createdAt));
+    out += FIELD_SEPARATOR;
+    appendNumber(out, static_cast<int64_t>(tx.updatedAt));
+    out += FIELD_SEPARATOR;
+    out += tx.isDeleted ? '1' : '0';
+    return out;
+}
+
+bool TransactionLog::decodeRow(std::string_view line, Transaction& tx) {
+    return decodeFields(splitFields(line.data(), line.data() + line.size()), 0, tx);
+}
+
+std::string TransactionLog::encodeRecord(LogOp op, const Transaction& tx) {
+    std::string body(1, static_cast<char>(op));
+    body += FIELD_SEPARATOR;
+    body += encodeRow(tx);
+    return seal(std::move(body));
+}
+
+std::string TransactionLog::encodeGeneration(uint64_t generation) {
+    std::string body(1, static_cast<char>(LogOp::GENERATION));
+    body += FIELD_SEPARATOR;
+    appendNumber(body, generation);
+    return seal(std::move(body));
+}
+
+std::string TransactionLog::encodeBatch(uint64_t count) {
+    std::string body(1, static_cast<char>(LogOp::BATCH));
+    body += FIELD_SEPARATOR;
+    appendNumber(body, count);
+    return seal(std::move(body));
+}
+
+size_t TransactionLog::replay(std::string_view log,
+                              const std::function<void(const LogRecord&)>& visitor) {
+    size_t offset = 0;
+    LogRecord record;
+    uint64_t batchSize = 0;
+
+    while (offset < log.size()) {
+        size_t next = parseRecord(log, offset, record, batchSize);
+        if (next == std::string_view::npos) {
+            break;
+        }
+
+        if (record.op == LogOp::BATCH) {
+            // Check the whole batch before applying any of it, so a batch
+            // torn by a crash is dropped as a unit
+            size_t batchEnd = next;
+            uint64_t remaining = batchSize;
+            while (remaining > 0 && batchEnd != std::string_view::npos) {
+                batchEnd = parseRecord(log, batchEnd, record, batchSize);
+                if (batchEnd != std::string_view::npos && !isRowRecord(record.op)) {
+                    batchEnd = std::string_view::npos;
+                }
+                --remaining;
+            }
+            if (batchEnd == std::string_view::npos) {
+                break;
+            }
+
+            while (next < batchEnd) {
+                next = parseRecord(log, next, record, batchSize);
+                visitor(record);
+            }
+        } else {
+            visitor(record);
+        }
+        offset = next;
+    }
+
+    return offset;
+}
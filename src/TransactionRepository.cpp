@@ -1,142 +1,1044 @@
-#include "../include/storage/TransactionRepository.h"
-#include <algorithm>
-#include <ctime>
-#include <iostream>
-#include <sstream>
-
-TransactionRepository::TransactionRepository(std::shared_ptr<IStorage> _storage)
-    : storage(_storage) {
-    loadFromStorage();
-}
-
-TransactionRepository::~TransactionRepository() {
-    saveToStorage();
-}
-
-std::string TransactionRepository::generateId() {
-    static int counter = 0;
-    return "tx_" + std::to_string(time(nullptr)) + "_" + std::to_string(counter++);
-}
-
-Transaction TransactionRepository::add(const Transaction& tx) {
-    Transaction newTx = tx;
-    if (newTx.id.empty()) {
-        newTx.id = generateId();
-    }
-    newTx.createdAt = time(nullptr);
-    newTx.updatedAt = newTx.createdAt;
-    newTx.isDeleted = false;
-
-    transactions.push_back(newTx);
-    saveToStorage();
-    return newTx;
-}
-
-Transaction TransactionRepository::update(const Transaction& tx) {
-    auto it = std::find_if(transactions.begin(), transactions.end(),
-                          [&tx](const Transaction& t) { return t.id == tx.id; });
-
-    if (it != transactions.end()) {
-        *it = tx;
-        it->updatedAt = time(nullptr);
-        saveToStorage();
-        return *it;
-    }
-
-    throw std::runtime_error("Transaction not found: " + tx.id);
-}
-
-void TransactionRepository::remove(const std::string& txId) {
-    auto it = std::find_if(transactions.begin(), transactions.end(),
-                          [&txId](const Transaction& t) { return t.id == txId; });
-
-    if (it != transactions.end()) {
-        it->isDeleted = true;
-        saveToStorage();
-    }
-}
-
-std::vector<Transaction> TransactionRepository::find(const TransactionFilter& filter) const {
-    std::vector<Transaction> result;
-
-    for (const auto& tx : transactions) {
-        if (tx.isDeleted) continue;
-
-        if (!filter.categoryId.empty() && tx.categoryId != filter.categoryId) {
-            continue;
-        }
-
-        if (filter.type && *filter.type != tx.type) {
-            continue;
-        }
-
-        if (filter.dateFrom > 0 && tx.date < filter.dateFrom) {
-            continue;
-        }
-
-        if (filter.dateTo > 0 && tx.date > filter.dateTo) {
-            continue;
-        }
-
-        if (!filter.keyword.empty() && tx.note.find(filter.keyword) == std::string::npos) {
-            continue;
-        }
-
-        result.push_back(tx);
-    }
-
-    return result;
-}
-
-Transaction TransactionRepository::getById(const std::string& id) const {
-    auto it = std::find_if(transactions.begin(), transactions.end(),
-                          [&id](const Transaction& t) { return t.id == id && !t.isDeleted; });
-
-    if (it != transactions.end()) {
-        return *it;
-    }
-
-    throw std::runtime_error("Transaction not found: " + id);
-}
-
-std::vector<Transaction> TransactionRepository::getAll() const {
-    std::vector<Transaction> result;
-    for (const auto& tx : transactions) {
-        if (!tx.isDeleted) {
-            result.push_back(tx);
-        }
-    }
-    return result;
-}
-
-void TransactionRepository::loadFromStorage() {
-    try {
-        std::string data = storage->load("transactions");
-        if (data.empty()) {
-            return;
-        }
-
-        // Simple CSV-like parsing for demo purposes
-        // In production, use a proper JSON library
-        std::cerr << "Note: Using simplified storage format" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Error loading transactions: " << e.what() << std::endl;
-    }
-}
-
-void TransactionRepository::saveToStorage() {
-    try {
-        std::string content;
-        for (const auto& tx : transactions) {
-            content += tx.id + "|" + std::to_string(tx.amount) + "|" +
-                      std::to_string(static_cast<int>(tx.type)) + "|" +
-                      std::to_string(tx.date) + "|" + tx.categoryId + "|" +
-                      tx.note + "|" + std::to_string(tx.createdAt) + "|" +
-                      std::to_string(tx.updatedAt) + "|" +
-                      (tx.isDeleted ? "1" : "0") + "\n";
-        }
-        storage->save("transactions", content);
-    } catch (const std::exception& e) {
-        std::cerr << "Error saving transactions: " << e.what() << std::endl;
-    }
-}
+#include "../include/storage/TransactionRepository.h"
+#include "../include/storage/TransactionSnapshot.h"
+#include "../include/util/ThreadPool.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+namespace {
+
+const char* const SNAPSHOT_KEY = "transactions.snap";
+const char* const LEGACY_SNAPSHOT_KEY = "transactions";
+const char* const LOG_KEY = "transactions.wal";
+const char* const CATEGORIES_KEY = "categories.csv";
+const char* const GENERATION_HEADER = "#generation|";
+const size_t DEFAULT_CHECKPOINT_MIN_BYTES = 1 << 20;
+const size_t BATCH_APPEND_BYTES = 1 << 20;   // log bytes buffered per append by a batch
+
+} // namespace
+
+TransactionRepository::TransactionRepository(std::shared_ptr<IStorage> _storage,
+                                             PersistenceMode mode)
+    : storage(_storage), categoryRegistry(std::make_shared<CategoryRegistry>()),
+      textArena(std::make_shared<TextArena>()), textAbandoned(0),
+      segments(std::make_shared<TransactionView::Directory>()), directoryPublished(false), rowCount(0), liveCount(0), version(0), publishedRows(0), columnarEnabled(true), idCounter(0),
+      nextSubscription(0), persistenceMode(mode), generation(0), logBytes(0), logBroken(false),
+      snapshotBytes(0), checkpointMinBytes(DEFAULT_CHECKPOINT_MIN_BYTES) {
+    loadFromStorage();
+    publish();
+    compactIfDue();
+}
+
+TransactionRepository::~TransactionRepository() {
+    if (persistenceMode == PersistenceMode::SNAPSHOT) {
+        saveToStorage();
+    } else if (logBytes > 0 || logBroken) {
+        writeCheckpoint();
+    }
+}
+
+std::string TransactionRepository::generateId() {
+    // The caller holds writeMutex or indexMutex, so idIndex is stable here
+    std::string id;
+    do {
+        id = "tx_" + std::to_string(time(nullptr)) + "_" + std::to_string(idCounter++);
+    } while (idIndex.count(id) > 0);
+    return id;
+}
+
+size_t TransactionRepository::findSlot(const std::string& id) const {
+    auto it = idIndex.find(id);
+    return it != idIndex.end() ? it->second : SIZE_MAX;
+}
+
+const TransactionChunk& TransactionRepository::chunkFor(size_t slot) const {
+    size_t chunk = slot / TransactionChunk::ROWS;
+    return *(*segments)[chunk / TransactionSegment::CHUNKS]->chunks[chunk % TransactionSegment::CHUNKS];
+}
+
+bool TransactionRepository::isDeleted(size_t slot) const {
+    return chunkFor(slot).columns.isDeleted(slot % TransactionChunk::ROWS);
+}
+
+Transaction TransactionRepository::row(size_t slot) const {
+    const TransactionChunk& chunk = chunkFor(slot);
+    size_t offset = slot % TransactionChunk::ROWS;
+    Transaction tx;
+    chunk.load(offset, categoryRegistry->id(chunk.columns.categoryCode(offset)), tx);
+    return tx;
+}
+
+void TransactionRepository::storeRow(size_t slot, const Transaction& tx) {
+    size_t index = slot / TransactionChunk::ROWS;
+    size_t offset = slot % TransactionChunk::ROWS;
+    size_t segmentIndex = index / TransactionSegment::CHUNKS;
+    bool appending = (slot == rowCount);
+
+    if (segmentIndex == segments->size() || slot < publishedRows) {
+        if (directoryPublished) {
+            segments = std::make_shared<TransactionView::Directory>(*segments);
+            directoryPublished = false;
+        }
+        if (segmentIndex == segments->size()) {
+            segments->push_back(std::make_shared<TransactionSegment>());
+        } else {
+            // Published views may be reading this chunk; change a copy of
+            // it, referenced from a copy of its segment
+            auto segment = std::make_shared<TransactionSegment>(*(*segments)[segmentIndex]);
+            auto& copy = segment->chunks[index % TransactionSegment::CHUNKS];
+            copy = std::make_shared<TransactionChunk>(*copy);
+            (*segments)[segmentIndex] = std::move(segment);
+        }
+    }
+
+    auto& entry = (*segments)[segmentIndex]->chunks[index % TransactionSegment::CHUNKS];
+    if (!entry) {
+        entry = std::make_shared<TransactionChunk>();   // a slot no published view reads
+    }
+    TransactionChunk& chunk = *entry;
+    int64_t previousDate = chunk.columns.date(offset);
+
+    // Text the slot or the id index already holds is reused, so updates
+    // that leave the id and note alone add nothing to the arena
+    CompactText id;
+    CompactText note;
+    bool replacing = !appending;
+    if (replacing && chunk.id(offset) == tx.id) {
+        id = chunk.records[offset].id;
+    } else {
+        auto known = idIndex.find(tx.id);
+        id = CompactText::external(known != idIndex.end() ? known->first : textArena->store(tx.id));
+    }
+    if (replacing && chunk.note(offset) == tx.note) {
+        note = chunk.records[offset].note;
+    } else {
+        if (replacing && !chunk.records[offset].note.isInline()) {
+            textAbandoned += chunk.note(offset).size();
+        }
+        note = CompactText::make(tx.note, *textArena);
+    }
+    chunk.store(offset, tx, categoryRegistry->intern(tx.categoryId), id, note);
+
+    if (appending) {
+        if (offset + 1 == TransactionChunk::ROWS) {
+            chunk.seal();
+        }
+    } else if ((index + 1) * TransactionChunk::ROWS <= rowCount &&
+               previousDate != static_cast<int64_t>(tx.date)) {
+        chunk.reseal(offset);
+    }
+}
+
+void TransactionRepository::publish() {
+    auto view = std::make_shared<const TransactionView>(segments, categoryRegistry->ids(), textArena,
+                                                        rowCount, liveCount, version, columnarEnabled);
+    directoryPublished = true;
+    publishedRows = rowCount;
+
+    std::lock_guard<std::mutex> lock(viewMutex);
+    current = std::move(view);
+}
+
+std::shared_ptr<const TransactionView> TransactionRepository::snapshot() const {
+    std::lock_guard<std::mutex> lock(viewMutex);
+    return current;
+}
+
+void TransactionRepository::rebuildIndexes() {
+    idIndex.clear();
+    categoryIndex.clear();
+    noteIndex.clear();
+    tombstoneTimes.clear();
+    liveCount = 0;
+    idIndex.reserve(rowCount);
+    for (size_t slot = 0; slot < rowCount; ++slot) {
+        const TransactionChunk& chunk = chunkFor(slot);
+        size_t offset = slot % TransactionChunk::ROWS;
+        // Later rows win, matching the order in which the log applies them
+        idIndex[chunk.id(offset)] = slot;
+        if (chunk.columns.isDeleted(offset)) {
+            tombstoneTimes.push_back(chunk.updatedAt(offset));
+        } else {
+            addToSecondaryIndexes(slot);
+        }
+    }
+    std::sort(tombstoneTimes.begin(), tombstoneTimes.end());
+}
+
+void TransactionRepository::addToSecondaryIndexes(size_t slot) {
+    const TransactionChunk& chunk = chunkFor(slot);
+    size_t offset = slot % TransactionChunk::ROWS;
+    if (chunk.columns.isDeleted(offset)) {
+        // Removals arrive in time order, so this is almost always an append
+        time_t removedAt = chunk.updatedAt(offset);
+        tombstoneTimes.insert(std::upper_bound(tombstoneTimes.begin(), tombstoneTimes.end(), removedAt),
+                              removedAt);
+        return;
+    }
+
+    ++liveCount;
+    uint32_t code = chunk.columns.categoryCode(offset);
+    if (code >= categoryIndex.size()) {
+        categoryIndex.resize(code + 1);
+    }
+    auto& postings = categoryIndex[code];
+    // Slots are mostly appended in increasing order; keep the list sorted
+    // so results come back in storage order
+    if (postings.empty() || postings.back() < slot) {
+        postings.push_back(slot);
+    } else {
+        postings.insert(std::lower_bound(postings.begin(), postings.end(), slot), slot);
+    }
+    noteIndex.add(static_cast<uint32_t>(slot), chunk.note(offset));
+}
+
+void TransactionRepository::removeFromSecondaryIndexes(size_t slot) {
+    const TransactionChunk& chunk = chunkFor(slot);
+    size_t offset = slot % TransactionChunk::ROWS;
+    if (chunk.columns.isDeleted(offset)) {
+        time_t removedAt = chunk.updatedAt(offset);
+        auto removed = std::lower_bound(tombstoneTimes.begin(), tombstoneTimes.end(), removedAt);
+        if (removed != tombstoneTimes.end() && *removed == removedAt) {
+            tombstoneTimes.erase(removed);
+        }
+        return;
+    }
+
+    --liveCount;
+    auto& postings = categoryIndex[chunk.columns.categoryCode(offset)];
+    auto it = std::lower_bound(postings.begin(), postings.end(), slot);
+    if (it != postings.end() && *it == slot) {
+        postings.erase(it);
+    }
+    noteIndex.remove(static_cast<uint32_t>(slot), chunk.note(offset));
+}
+
+void TransactionRepository::appendRow(const Transaction& tx) {
+    size_t slot = rowCount;
+    storeRow(slot, tx);
+    ++rowCount;
+    idIndex[chunkFor(slot).id(slot % TransactionChunk::ROWS)] = slot;
+    addToSecondaryIndexes(slot);
+}
+
+void TransactionRepository::replaceRow(size_t slot, const Transaction& tx) {
+    // A live row keeping its category and note keeps its postings. Moving
+    // it out of and back into the lists of common trigrams would cost time
+    // proportional to the ledger.
+    const TransactionChunk& chunk = chunkFor(slot);
+    size_t offset = slot % TransactionChunk::ROWS;
+    if (!tx.isDeleted && !chunk.columns.isDeleted(offset) &&
+        chunk.columns.categoryCode(offset) == categoryRegistry->intern(tx.categoryId) &&
+        chunk.note(offset) == tx.note) {
+        storeRow(slot, tx);
+        return;
+    }
+    removeFromSecondaryIndexes(slot);
+    storeRow(slot, tx);
+    addToSecondaryIndexes(slot);
+}
+
+Transaction TransactionRepository::add(const Transaction& tx) {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    Transaction newTx = tx;
+    if (newTx.id.empty()) {
+        newTx.id = generateId();
+    } else {
+        size_t slot = findSlot(newTx.id);
+        if (slot != SIZE_MAX && !isDeleted(slot)) {
+            throw std::runtime_error("Transaction already exists: " + newTx.id);
+        }
+    }
+    newTx.createdAt = time(nullptr);
+    newTx.updatedAt = newTx.createdAt;
+    newTx.isDeleted = false;
+    newTx.categoryCode = categoryRegistry->intern(newTx.categoryId);
+
+    logMutation(LogOp::ADD, newTx);
+    {
+        std::unique_lock<std::shared_mutex> indexLock(indexMutex);
+        appendRow(newTx);
+        ++version;
+        publish();
+    }
+    checkpointIfDue();
+    notifyObservers(nullptr, newTx, version);
+    return newTx;
+}
+
+std::vector<Transaction> TransactionRepository::addMany(const std::vector<Transaction>& txs) {
+    TransactionBatch batch = beginBatch();
+    batch.reserve(txs.size());
+    for (const auto& tx : txs) {
+        batch.add(tx);
+    }
+
+    commitBatch(batch.rows);
+    return std::move(batch.rows);
+}
+
+TransactionBatch TransactionRepository::beginBatch() {
+    return TransactionBatch(*this);
+}
+
+size_t TransactionRepository::commitBatch(std::vector<Transaction>& rows) {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    for (const auto& tx : rows) {
+        size_t slot = findSlot(tx.id);
+        if (slot != SIZE_MAX && !isDeleted(slot)) {
+            throw std::runtime_error("Transaction already exists: " + tx.id);
+        }
+    }
+    if (rows.empty()) {
+        return 0;
+    }
+
+    // The new slots lie past every published one, so they are stored
+    // without blocking readers; only the index update and publication do
+    time_t now = time(nullptr);
+    size_t firstSlot = rowCount;
+    for (auto& tx : rows) {
+        tx.createdAt = now;
+        tx.updatedAt = now;
+        tx.isDeleted = false;
+        tx.categoryCode = categoryRegistry->intern(tx.categoryId);
+        storeRow(rowCount, tx);
+        ++rowCount;
+    }
+
+    // Written before the index update and publication, so a batch that
+    // cannot be persisted is dropped again before anyone has seen it
+    try {
+        persistBatch(firstSlot, rows);
+    } catch (const std::exception&) {
+        rowCount = firstSlot;
+        if (logBroken) {
+            // Replace the torn batch now rather than at the next write
+            writeCheckpoint();
+        }
+        throw;
+    }
+
+    {
+        // The new slots are all larger than the indexed ones, so category
+        // and note postings only grow at the back
+        std::unique_lock<std::shared_mutex> indexLock(indexMutex);
+        idIndex.reserve(rowCount);
+        categoryIndex.resize(std::max(categoryIndex.size(), categoryRegistry->size()));
+        for (size_t slot = firstSlot; slot < rowCount; ++slot) {
+            const TransactionChunk& chunk = chunkFor(slot);
+            size_t offset = slot % TransactionChunk::ROWS;
+            idIndex[chunk.id(offset)] = slot;
+            ++liveCount;
+            categoryIndex[chunk.columns.categoryCode(offset)].push_back(slot);
+            noteIndex.add(static_cast<uint32_t>(slot), chunk.note(offset));
+        }
+        version += rows.size();
+        publish();
+    }
+
+    uint64_t firstVersion = version - rows.size();
+    for (size_t i = 0; i < rows.size(); ++i) {
+        notifyObservers(nullptr, rows[i], firstVersion + i + 1);
+    }
+    return rows.size();
+}
+
+const Transaction& TransactionBatch::add(const Transaction& tx) {
+    Transaction staged = tx;
+    {
+        std::shared_lock<std::shared_mutex> lock(repository.indexMutex);
+        if (staged.id.empty()) {
+            do {
+                staged.id = repository.generateId();
+            } while (ids.count(staged.id) > 0);
+        } else {
+            size_t slot = repository.findSlot(staged.id);
+            bool live = slot != SIZE_MAX && !repository.snapshot()->isDeleted(slot);
+            if (live || ids.count(staged.id) > 0) {
+                throw std::runtime_error("Transaction already exists: " + staged.id);
+            }
+        }
+    }
+
+    ids.insert(staged.id);
+    rows.push_back(std::move(staged));
+    return rows.back();
+}
+
+size_t TransactionBatch::commit() {
+    size_t added = repository.commitBatch(rows);
+    rows.clear();
+    ids.clear();
+    return added;
+}
+
+void TransactionBatch::reserve(size_t count) {
+    rows.reserve(count);
+    ids.reserve(count);
+}
+
+Transaction TransactionRepository::update(const Transaction& tx) {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    size_t slot = findSlot(tx.id);
+
+    if (slot != SIZE_MAX) {
+        Transaction previous = row(slot);
+        Transaction updated = tx;
+        updated.updatedAt = time(nullptr);
+        updated.categoryCode = categoryRegistry->intern(updated.categoryId);
+        logMutation(LogOp::UPDATE, updated);
+        {
+            std::unique_lock<std::shared_mutex> indexLock(indexMutex);
+            replaceRow(slot, updated);
+            ++version;
+            publish();
+        }
+        checkpointIfDue();
+        notifyObservers(&previous, updated, version);
+        return updated;
+    }
+
+    throw std::runtime_error("Transaction not found: " + tx.id);
+}
+
+void TransactionRepository::remove(const std::string& txId) {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    size_t slot = findSlot(txId);
+
+    if (slot != SIZE_MAX) {
+        Transaction previous = row(slot);
+        Transaction removed = previous;
+        removed.isDeleted = true;
+        removed.updatedAt = time(nullptr);   // when the retention window starts
+        logMutation(LogOp::REMOVE, removed);
+        {
+            std::unique_lock<std::shared_mutex> indexLock(indexMutex);
+            replaceRow(slot, removed);
+            ++version;
+            publish();
+        }
+        checkpointIfDue();
+        notifyObservers(&previous, removed, version);
+        compactIfDue();
+    }
+}
+
+std::vector<Transaction> TransactionRepository::find(const TransactionFilter& filter) const {
+    std::vector<Transaction> result;
+    forEach(filter, [&result](const Transaction& tx) { result.push_back(tx); });
+    return result;
+}
+
+void TransactionRepository::forEach(const TransactionFilter& filter,
+                                    const TransactionVisitor& visitor) const {
+    std::vector<std::string> terms = NoteIndex::tokenize(filter.keyword);
+    if (filter.dateFrom > 0 && filter.dateTo > 0 && filter.dateFrom > filter.dateTo) {
+        return;
+    }
+    uint32_t categoryCode = CategoryRegistry::NONE;
+    if (!filter.categoryId.empty()) {
+        categoryCode = categoryRegistry->find(filter.categoryId);
+        if (categoryCode == CategoryRegistry::NONE) {
+            return;
+        }
+    }
+
+    // Plan: every index covers live rows only, so its size is an upper bound
+    // on the candidates it yields (the date count includes tombstones, which
+    // only overstates it). Pick the smallest; the date range is only counted
+    // until it loses to the best alternative. Index candidates are copied
+    // out so the rows can be visited after the lock is released.
+    enum class AccessPath { FULL_SCAN, CATEGORY, DATE, NOTE };
+    AccessPath path = AccessPath::FULL_SCAN;
+    std::shared_ptr<const TransactionView> view;
+    std::vector<size_t> slots;
+    {
+        std::shared_lock<std::shared_mutex> lock(indexMutex);
+        view = snapshot();
+        size_t bestEstimate = view->size();
+
+        const std::vector<size_t>* postings = nullptr;
+        if (!filter.categoryId.empty()) {
+            if (categoryCode >= categoryIndex.size() || categoryIndex[categoryCode].empty()) {
+                return;
+            }
+            postings = &categoryIndex[categoryCode];
+            if (postings->size() < bestEstimate) {
+                path = AccessPath::CATEGORY;
+                bestEstimate = postings->size();
+            }
+        }
+
+        if (noteIndex.isIndexable(terms)) {
+            size_t estimate = noteIndex.estimate(terms);
+            if (estimate < bestEstimate) {
+                path = AccessPath::NOTE;
+                bestEstimate = estimate;
+            }
+        }
+
+        if ((filter.dateFrom > 0 || filter.dateTo > 0) &&
+            view->countInDateRange(filter.dateFrom, filter.dateTo, bestEstimate) < bestEstimate) {
+            path = AccessPath::DATE;
+        }
+
+        if (path == AccessPath::CATEGORY) {
+            slots = *postings;
+        } else if (path == AccessPath::NOTE) {
+            std::vector<uint32_t> candidates = noteIndex.candidates(terms);
+            slots.assign(candidates.begin(), candidates.end());
+        }
+    }
+
+    // Candidates are checked against their columns and stored note; only
+    // the rows that match are rebuilt
+    RowConditions conditions;
+    conditions.categoryCode = categoryCode;
+    conditions.type = filter.type;
+    conditions.dateFrom = filter.dateFrom;
+    conditions.dateTo = filter.dateTo;
+    conditions.noteTerms = terms.empty() ? nullptr : &terms;
+    switch (path) {
+        case AccessPath::DATE:
+            view->forEachInDateRange(conditions, visitor);
+            break;
+        case AccessPath::NOTE:
+        case AccessPath::CATEGORY: {
+            Transaction tx;
+            for (size_t slot : slots) {
+                if (view->satisfies(slot, conditions)) {
+                    view->load(slot, tx);
+                    visitor(tx);
+                }
+            }
+            break;
+        }
+        case AccessPath::FULL_SCAN:
+            view->forEach(conditions, visitor);
+            break;
+    }
+}
+
+Transaction TransactionRepository::getById(const std::string& id) const {
+    {
+        std::shared_lock<std::shared_mutex> lock(indexMutex);
+        size_t slot = findSlot(id);
+        if (slot != SIZE_MAX) {
+            auto view = snapshot();
+            if (!view->isDeleted(slot)) {
+                return view->at(slot);
+            }
+        }
+    }
+
+    throw std::runtime_error("Transaction not found: " + id);
+}
+
+std::vector<Transaction> TransactionRepository::getAll() const {
+    auto view = snapshot();
+    std::vector<Transaction> result;
+    result.reserve(view->liveCount());
+    for (size_t slot = 0; slot < view->size(); ++slot) {
+        if (!view->isDeleted(slot)) {
+            result.emplace_back();
+            view->load(slot, result.back());
+        }
+    }
+    return result;
+}
+
+void TransactionRepository::forEach(const TransactionVisitor& visitor) const {
+    snapshot()->forEach(visitor);
+}
+
+size_t TransactionRepository::count() const {
+    return snapshot()->liveCount();
+}
+
+ColumnSum TransactionRepository::sumAmounts(time_t from, time_t to, TransactionType type,
+                                            ThreadPool* pool) const {
+    return snapshot()->sumAmounts(from, to, type, pool);
+}
+
+std::map<std::string, ColumnSum> TransactionRepository::sumByCategory(time_t from, time_t to,
+                                                                     TransactionType type,
+                                                                     ThreadPool* pool) const {
+    return snapshot()->sumByCategory(from, to, type, pool);
+}
+
+void TransactionRepository::defineCategory(const Category& category) {
+    if (category.id.empty()) {
+        throw std::runtime_error("Category id must not be empty");
+    }
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    categoryRegistry->define(category);
+    saveCategories();
+}
+
+std::vector<Category> TransactionRepository::getCategories() const {
+    return categoryRegistry->definitions();
+}
+
+MemoryUsage TransactionRepository::memoryUsage() const {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    MemoryUsage usage;
+    usage.rows = rowCount;
+    usage.tombstones = tombstoneTimes.size();
+
+    usage.chunkBytes = segments->capacity() * sizeof(std::shared_ptr<TransactionSegment>);
+    for (const auto& segment : *segments) {
+        usage.chunkBytes += sizeof(TransactionSegment);
+        for (const auto& chunk : segment->chunks) {
+            if (chunk) {
+                usage.chunkBytes += chunk->memoryBytes();
+            }
+        }
+    }
+
+    usage.textBytes = textArena->bytesReserved();
+    usage.textAbandoned = textAbandoned;
+
+    // An id index node holds a next pointer, the entry and the cached hash
+    usage.indexBytes = idIndex.bucket_count() * sizeof(void*) +
+                       idIndex.size() * (sizeof(void*) + sizeof(std::pair<const std::string_view, size_t>) +
+                                         sizeof(size_t));
+    usage.indexBytes += categoryIndex.capacity() * sizeof(std::vector<size_t>);
+    for (const auto& postings : categoryIndex) {
+        usage.indexBytes += postings.capacity() * sizeof(size_t);
+    }
+    usage.indexBytes += noteIndex.memoryBytes();
+    usage.indexBytes += tombstoneTimes.capacity() * sizeof(time_t);
+    return usage;
+}
+
+void TransactionRepository::setColumnarStoreEnabled(bool enabled) {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    columnarEnabled = enabled;
+    publish();
+}
+
+size_t TransactionRepository::subscribe(TransactionObserver observer) {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    size_t subscription = nextSubscription++;
+    observers.emplace_back(subscription, std::move(observer));
+    return subscription;
+}
+
+void TransactionRepository::unsubscribe(size_t subscription) {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    observers.erase(std::remove_if(observers.begin(), observers.end(),
+                                   [subscription](const std::pair<size_t, TransactionObserver>& entry) {
+                                       return entry.first == subscription;
+                                   }),
+                    observers.end());
+}
+
+void TransactionRepository::notifyObservers(const Transaction* before, const Transaction& after,
+                                            uint64_t atVersion) {
+    for (auto& entry : observers) {
+        entry.second(before, after, atVersion);
+    }
+}
+
+void TransactionRepository::checkpoint() {
+    {
+        std::lock_guard<std::mutex> writeLock(writeMutex);
+        if (!writeCheckpoint()) {
+            throw std::runtime_error("Failed to write transaction snapshot");
+        }
+    }
+    storage->flush();
+}
+
+bool TransactionRepository::writeCheckpoint() {
+    // The new snapshot gets a new generation first, so a log left behind by
+    // a crash between the two writes is recognised as stale on the next load
+    ++generation;
+    if (!saveToStorage()) {
+        // The old snapshot and the log still hold every row; keep appending
+        // to them and try again at the next checkpoint
+        --generation;
+        return false;
+    }
+    if (logBytes > 0 || logBroken) {
+        try {
+            storage->save(LOG_KEY, "");
+            logBroken = false;
+        } catch (const std::exception& e) {
+            // A whole log left behind is harmless, its generation no longer
+            // matching the snapshot; a torn one stays broken
+            std::cerr << "Error truncating transaction log: " << e.what() << std::endl;
+        }
+        logBytes = 0;
+    }
+    return true;
+}
+
+void TransactionRepository::setCheckpointMinBytes(size_t bytes) {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    checkpointMinBytes = bytes;
+}
+
+size_t TransactionRepository::compact() {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    return compactTombstones(time(nullptr) - compactionPolicy.retention);
+}
+
+void TransactionRepository::setCompactionPolicy(const CompactionPolicy& policy) {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    compactionPolicy = policy;
+    compactIfDue();
+}
+
+CompactionPolicy TransactionRepository::getCompactionPolicy() const {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    return compactionPolicy;
+}
+
+void TransactionRepository::compactIfDue() {
+    time_t cutoff = time(nullptr) - compactionPolicy.retention;
+    size_t expired = std::upper_bound(tombstoneTimes.begin(), tombstoneTimes.end(), cutoff) -
+                     tombstoneTimes.begin();
+    if (expired > 0 && expired >= compactionPolicy.minReclaimable &&
+        expired >= compactionPolicy.deadRatio * rowCount) {
+        try {
+            compactTombstones(cutoff);
+        } catch (const std::exception& e) {
+            // The write that triggered it has already succeeded
+            std::cerr << "Error compacting transactions: " << e.what() << std::endl;
+        }
+    }
+}
+
+size_t TransactionRepository::compactTombstones(time_t cutoff) {
+    if (tombstoneTimes.empty() || tombstoneTimes.front() > cutoff) {
+        return 0;
+    }
+
+    // The kept rows are copied into new chunks, arena and indexes while
+    // readers carry on with the current ones; indexMutex is taken only to
+    // swap them in. Text is copied rather than referenced so the old arena,
+    // superseded notes and all, goes away with the last view using it.
+    auto compacted = std::make_shared<TransactionView::Directory>();
+    auto arena = std::make_shared<TextArena>();
+    std::unordered_map<std::string_view, size_t> ids;
+    std::vector<std::vector<size_t>> byCategory(categoryRegistry->size());
+    NoteIndex notes;
+    std::vector<time_t> tombstones;
+    ids.reserve(idIndex.size());
+
+    Transaction tx;
+    size_t kept = 0;
+    for (size_t slot = 0; slot < rowCount; ++slot) {
+        const TransactionChunk& source = chunkFor(slot);
+        size_t offset = slot % TransactionChunk::ROWS;
+        bool deleted = source.columns.isDeleted(offset);
+        if (deleted && source.updatedAt(offset) <= cutoff) {
+            continue;
+        }
+
+        size_t index = kept / TransactionChunk::ROWS;
+        size_t target = kept % TransactionChunk::ROWS;
+        if (target == 0 && index % TransactionSegment::CHUNKS == 0) {
+            compacted->push_back(std::make_shared<TransactionSegment>());
+        }
+        auto& entry = compacted->back()->chunks[index % TransactionSegment::CHUNKS];
+        if (!entry) {
+            entry = std::make_shared<TransactionChunk>();
+        }
+        TransactionChunk& chunk = *entry;
+
+        // A re-added id shares its text with the tombstone before it
+        auto known = ids.find(source.id(offset));
+        CompactText id = CompactText::external(known != ids.end() ? known->first
+                                                                  : arena->store(source.id(offset)));
+        const CompactText& sourceNote = source.records[offset].note;
+        CompactText note = sourceNote.isInline() ? sourceNote
+                                                 : CompactText::make(sourceNote.view(), *arena);
+        uint32_t code = source.columns.categoryCode(offset);
+        source.loadNumeric(offset, tx);
+        chunk.store(target, tx, code, id, note);
+        if (target + 1 == TransactionChunk::ROWS) {
+            chunk.seal();
+        }
+
+        ids[chunk.id(target)] = kept;
+        if (deleted) {
+            tombstones.push_back(tx.updatedAt);
+        } else {
+            byCategory[code].push_back(kept);
+            notes.add(static_cast<uint32_t>(kept), chunk.note(target));
+        }
+        ++kept;
+    }
+    std::sort(tombstones.begin(), tombstones.end());
+    size_t dropped = rowCount - kept;
+
+    {
+        std::unique_lock<std::shared_mutex> indexLock(indexMutex);
+        segments = std::move(compacted);
+        textArena = std::move(arena);
+        textAbandoned = 0;
+        idIndex.swap(ids);
+        categoryIndex.swap(byCategory);
+        std::swap(noteIndex, notes);
+        tombstoneTimes.swap(tombstones);
+        rowCount = kept;
+        publish();
+    }
+
+    // A fresh snapshot drops the rows from storage and truncates the log.
+    // Without it the old snapshot and log still load, tombstones included,
+    // so only the storage side of the compaction is lost.
+    if (!writeCheckpoint()) {
+        throw std::runtime_error("Compacted in memory, but failed to write transaction snapshot");
+    }
+    return dropped;
+}
+
+void TransactionRepository::logMutation(LogOp op, const Transaction& tx) {
+    // Runs before the change is published, so a mutation that throws here
+    // leaves the ledger as it was
+    if (persistenceMode == PersistenceMode::SNAPSHOT) {
+        return;
+    }
+    // Replay stops at a torn record and drops everything behind it, so a
+    // log that failed an append is replaced by a snapshot before reuse
+    if (logBroken) {
+        writeCheckpoint();
+        if (logBroken) {
+            throw std::runtime_error("Transaction log is damaged and could not be replaced");
+        }
+    }
+
+    std::string record;
+    if (logBytes == 0) {
+        record = TransactionLog::encodeGeneration(generation);
+    }
+    record += TransactionLog::encodeRecord(op, tx);
+    appendToLog(record);
+}
+
+void TransactionRepository::appendToLog(const std::string& records) {
+    try {
+        storage->append(LOG_KEY, records);
+    } catch (const std::exception& e) {
+        logBroken = true;
+        throw std::runtime_error(std::string("Failed to append to transaction log: ") + e.what());
+    }
+    logBytes += records.size();
+}
+
+void TransactionRepository::checkpointIfDue() {
+    if (persistenceMode == PersistenceMode::SNAPSHOT) {
+        saveToStorage();
+        return;
+    }
+    // Checkpoint once the log outgrows the snapshot, which keeps the
+    // amortized cost of a mutation proportional to the mutation itself.
+    // The log already holds the change, so a failure here loses nothing.
+    if (logBytes >= std::max(checkpointMinBytes, snapshotBytes)) {
+        writeCheckpoint();
+    }
+}
+
+void TransactionRepository::persistBatch(size_t firstSlot, const std::vector<Transaction>& rows) {
+    size_t added = rowCount - firstSlot;
+    if (persistenceMode == PersistenceMode::SNAPSHOT || added >= firstSlot || logBroken) {
+        // A batch at least as large as what was there before would push
+        // the log past the snapshot anyway, and a damaged log has to be
+        // replaced first; write the snapshot directly
+        if (!writeCheckpoint()) {
+            throw std::runtime_error("Failed to write transaction snapshot");
+        }
+        return;
+    }
+
+    // The BATCH marker makes replay apply the rows as a unit, so the
+    // records can go out in several appends. One that fails leaves an
+    // incomplete batch in the log, and appendToLog marks it broken.
+    std::string chunk;
+    if (logBytes == 0) {
+        chunk = TransactionLog::encodeGeneration(generation);
+    }
+    chunk += TransactionLog::encodeBatch(added);
+    for (const auto& tx : rows) {
+        chunk += TransactionLog::encodeRecord(LogOp::ADD, tx);
+        if (chunk.size() >= BATCH_APPEND_BYTES) {
+            appendToLog(chunk);
+            chunk.clear();
+        }
+    }
+    if (!chunk.empty()) {
+        appendToLog(chunk);
+    }
+
+    if (logBytes >= std::max(checkpointMinBytes, snapshotBytes)) {
+        writeCheckpoint();
+    }
+}
+
+void TransactionRepository::applyLogRecord(const LogRecord& record) {
+    // Updates and removals apply to the most recent row carrying the id
+    auto it = (record.op == LogOp::ADD) ? idIndex.end() : idIndex.find(record.tx.id);
+    if (it != idIndex.end()) {
+        replaceRow(it->second, record.tx);
+    } else {
+        appendRow(record.tx);
+    }
+}
+
+void TransactionRepository::loadFromStorage() {
+    try {
+        auto mapped = storage->map(SNAPSHOT_KEY);
+        if (mapped && TransactionSnapshot::isSnapshot(*mapped)) {
+            snapshotBytes = mapped->size();
+            loadSnapshot(mapped);
+        } else {
+            loadLegacySnapshot();
+        }
+        rebuildIndexes();
+        replayLog();
+    } catch (const std::exception& e) {
+        // Starting empty would let the next checkpoint overwrite the damaged
+        // snapshot and truncate the log, losing what is still recoverable
+        throw std::runtime_error(std::string("Failed to load transactions: ") + e.what());
+    }
+    loadCategories();
+}
+
+void TransactionRepository::loadCategories() {
+    try {
+        auto mapped = storage->map(CATEGORIES_KEY);
+        if (mapped) {
+            categoryRegistry->decodeDefinitions(std::string_view(mapped->data(), mapped->size()));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading categories: " << e.what() << std::endl;
+    }
+}
+
+void TransactionRepository::saveCategories() {
+    try {
+        storage->save(CATEGORIES_KEY, categoryRegistry->encodeDefinitions());
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving categories: " << e.what() << std::endl;
+    }
+}
+
+void TransactionRepository::loadSnapshot(std::shared_ptr<const MappedFile> mapped) {
+    TransactionSnapshot snapshot(mapped);
+    generation = snapshot.generation();
+
+    // Interning the dictionary first keeps every category on the code it
+    // had when the snapshot was written
+    for (uint32_t code = 0; code < snapshot.categoryCount(); ++code) {
+        categoryRegistry->intern(std::string(snapshot.category(code)));
+    }
+
+    // Rows are copied column by column out of the mapping; nothing is parsed
+    for (size_t slot = 0; slot < snapshot.size(); ++slot) {
+        storeRow(rowCount, snapshot.row(slot));
+        ++rowCount;
+    }
+}
+
+void TransactionRepository::loadLegacySnapshot() {
+    // Text snapshots written before the binary format: one pipe-delimited
+    // row per line, optionally preceded by a generation header
+    auto mapped = storage->map(LEGACY_SNAPSHOT_KEY);
+    if (!mapped) {
+        return;
+    }
+    snapshotBytes = mapped->size();
+
+    std::string_view data(mapped->data(), mapped->size());
+    size_t skipped = 0;
+    size_t lineStart = 0;
+    while (lineStart < data.size()) {
+        size_t lineEnd = data.find('\n', lineStart);
+        if (lineEnd == std::string_view::npos) {
+            lineEnd = data.size();
+        }
+        std::string_view line = data.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) continue;
+
+        if (line.compare(0, std::strlen(GENERATION_HEADER), GENERATION_HEADER) == 0) {
+            generation = std::stoull(std::string(line.substr(std::strlen(GENERATION_HEADER))));
+            continue;
+        }
+
+        Transaction tx;
+        if (TransactionLog::decodeRow(line, tx)) {
+            storeRow(rowCount, tx);
+            ++rowCount;
+        } else {
+            ++skipped;
+        }
+    }
+    if (skipped > 0) {
+        std::cerr << "Skipped " << skipped << " malformed transaction rows" << std::endl;
+    }
+}
+
+void TransactionRepository::replayLog() {
+    auto mapped = storage->map(LOG_KEY);
+    if (!mapped || mapped->empty()) {
+        return;
+    }
+    std::string_view log(mapped->data(), mapped->size());
+
+    // Only a log that extends the loaded snapshot is replayed
+    bool matchesSnapshot = false;
+    size_t consumed = TransactionLog::replay(log, [&](const LogRecord& record) {
+        if (record.op == LogOp::GENERATION) {
+            matchesSnapshot = (record.generation == generation);
+        } else if (matchesSnapshot) {
+            applyLogRecord(record);
+        }
+    });
+
+    if (!matchesSnapshot) {
+        storage->save(LOG_KEY, "");
+        return;
+    }
+
+    if (consumed < log.size()) {
+        std::cerr << "Discarding " << (log.size() - consumed)
+                  << " bytes of incomplete transaction log" << std::endl;
+        storage->save(LOG_KEY, std::string(log.substr(0, consumed)));
+    }
+    logBytes = consumed;
+
+    if (persistenceMode == PersistenceMode::SNAPSHOT) {
+        writeCheckpoint();
+    }
+}
+
+bool TransactionRepository::saveToStorage() {
+    try {
+        auto categoryIds = categoryRegistry->ids();
+        std::string content = TransactionSnapshot::encode(
+            rowCount,
+            [&](size_t slot, Transaction& tx) {
+                const TransactionChunk& chunk = chunkFor(slot);
+                size_t offset = slot % TransactionChunk::ROWS;
+                chunk.load(offset, (*categoryIds)[chunk.columns.categoryCode(offset)], tx);
+            },
+            *categoryIds, generation);
+        storage->save(SNAPSHOT_KEY, content);
+        snapshotBytes = content.size();
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving transactions: " << e.what() << std::endl;
+        return false;
+    }
+}
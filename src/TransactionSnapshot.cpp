@@ -0,0 +1,263 @@
+#include "../include/storage/TransactionSnapshot.h"
+#include "../include/storage/TransactionLog.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+const char MAGIC[8] = {'T', 'X', 'S', 'N', 'A', 'P', '\0', '\0'};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerCrc;     // CRC32 of the header with this field zeroed
+    uint64_t generation;
+    uint64_t rowCount;
+    uint64_t heapSize;
+    uint64_t categoryCount;
+    uint64_t offsets[TransactionSnapshot::COLUMN_COUNT];
+};
+
+// Version 1: no dictionary, categoryId stored per row as a string
+struct SnapshotHeaderV1 {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerCrc;
+    uint64_t generation;
+    uint64_t rowCount;
+    uint64_t heapSize;
+    uint64_t offsets[10];   // the sections up to and including NOTE, then HEAP
+};
+
+size_t columnWidth(int column, uint32_t version) {
+    switch (column) {
+        case TransactionSnapshot::CATEGORY_CODE:
+            return version == 1 ? sizeof(TransactionSnapshot::StringRef) : 4;
+        case TransactionSnapshot::AMOUNT:
+        case TransactionSnapshot::DATE:
+        case TransactionSnapshot::CREATED_AT:
+        case TransactionSnapshot::UPDATED_AT:
+            return 8;
+        case TransactionSnapshot::TYPE:
+        case TransactionSnapshot::IS_DELETED:
+            return 1;
+        case TransactionSnapshot::ID:
+        case TransactionSnapshot::NOTE:
+            return sizeof(TransactionSnapshot::StringRef);
+        default:
+            return 0;
+    }
+}
+
+size_t align8(size_t offset) {
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+template <typename Header>
+uint32_t headerChecksum(Header header) {
+    header.headerCrc = 0;
+    return TransactionLog::crc32(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+template <typename T>
+void put(std::string& out, size_t offset, const T& value) {
+    std::memcpy(&out[offset], &value, sizeof(T));
+}
+
+template <typename T>
+T get(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+bool TransactionSnapshot::isSnapshot(const MappedFile& file) {
+    return file.size() >= sizeof(MAGIC) && std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+TransactionSnapshot::TransactionSnapshot(std::shared_ptr<const MappedFile> _file)
+    : file(_file), snapshotGeneration(0), rowCount(0), heapSize(0), categories(0), formatVersion(0) {
+    if (!file || file->size() < sizeof(SnapshotHeaderV1) || !isSnapshot(*file)) {
+        throw std::runtime_error("Not a transaction snapshot");
+    }
+
+    SnapshotHeader header;
+    formatVersion = get<uint32_t>(file->data() + offsetof(SnapshotHeader, version));
+    if (formatVersion == 1) {
+        SnapshotHeaderV1 legacy;
+        std::memcpy(&legacy, file->data(), sizeof(legacy));
+        if (legacy.headerCrc != headerChecksum(legacy)) {
+            throw std::runtime_error("Snapshot header checksum mismatch");
+        }
+        header.generation = legacy.generation;
+        header.rowCount = legacy.rowCount;
+        header.heapSize = legacy.heapSize;
+        header.categoryCount = 0;
+        std::copy(legacy.offsets, legacy.offsets + NOTE + 1, header.offsets);
+        header.offsets[CATEGORIES] = legacy.offsets[NOTE];   // empty
+        header.offsets[HEAP] = legacy.offsets[NOTE + 1];
+    } else if (formatVersion == 2 || formatVersion == VERSION) {
+        if (file->size() < sizeof(SnapshotHeader)) {
+            throw std::runtime_error("Snapshot is truncated or corrupted");
+        }
+        std::memcpy(&header, file->data(), sizeof(header));
+        if (header.headerCrc != headerChecksum(header)) {
+            throw std::runtime_error("Snapshot header checksum mismatch");
+        }
+    } else {
+        throw std::runtime_error("Unsupported snapshot version: " + std::to_string(formatVersion));
+    }
+
+    for (int column = 0; column < COLUMN_COUNT; ++column) {
+        uint64_t bytes = (column == HEAP)         ? header.heapSize
+                         : (column == CATEGORIES) ? header.categoryCount * sizeof(StringRef)
+                                                  : header.rowCount * columnWidth(column, formatVersion);
+        if (header.offsets[column] % 8 != 0 || header.offsets[column] > file->size() ||
+            bytes > file->size() - header.offsets[column]) {
+            throw std::runtime_error("Snapshot is truncated or corrupted");
+        }
+        offsets[column] = header.offsets[column];
+    }
+
+    snapshotGeneration = header.generation;
+    rowCount = static_cast<size_t>(header.rowCount);
+    heapSize = header.heapSize;
+    categories = static_cast<size_t>(header.categoryCount);
+}
+
+std::string TransactionSnapshot::encode(size_t rowCount,
+                                        const std::function<void(size_t, Transaction&)>& load,
+                                        const std::vector<std::string>& categoryIds,
+                                        uint64_t generation) {
+    SnapshotHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.headerCrc = 0;
+    header.generation = generation;
+    header.rowCount = rowCount;
+    header.heapSize = 0;
+    header.categoryCount = categoryIds.size();
+    for (const auto& categoryId : categoryIds) {
+        header.heapSize += categoryId.size();
+    }
+    Transaction tx;
+    for (size_t i = 0; i < rowCount; ++i) {
+        load(i, tx);
+        if (tx.categoryCode >= categoryIds.size()) {
+            throw std::runtime_error("Transaction " + tx.id + " has no category code");
+        }
+        header.heapSize += tx.id.size() + tx.note.size();
+    }
+    if (header.heapSize > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Snapshot string heap exceeds 4 GiB");
+    }
+
+    size_t offset = align8(sizeof(SnapshotHeader));
+    for (int column = 0; column < COLUMN_COUNT; ++column) {
+        header.offsets[column] = offset;
+        size_t bytes = (column == HEAP)         ? header.heapSize
+                       : (column == CATEGORIES) ? categoryIds.size() * sizeof(StringRef)
+                                                : rowCount * columnWidth(column, VERSION);
+        offset = align8(offset + bytes);
+    }
+    header.headerCrc = headerChecksum(header);
+
+    std::string out(offset, '\0');
+    std::memcpy(&out[0], &header, sizeof(header));
+
+    uint32_t heapOffset = 0;
+    auto putString = [&](Column column, size_t row, const std::string& value) {
+        StringRef ref{heapOffset, static_cast<uint32_t>(value.size())};
+        put(out, header.offsets[column] + row * sizeof(StringRef), ref);
+        std::memcpy(&out[header.offsets[HEAP] + heapOffset], value.data(), value.size());
+        heapOffset += ref.length;
+    };
+
+    for (size_t code = 0; code < categoryIds.size(); ++code) {
+        putString(CATEGORIES, code, categoryIds[code]);
+    }
+
+    for (size_t i = 0; i < rowCount; ++i) {
+        load(i, tx);
+        put(out, header.offsets[AMOUNT] + i * 8, tx.amount.minorUnits());
+        put(out, header.offsets[DATE] + i * 8, static_cast<int64_t>(tx.date));
+        put(out, header.offsets[CREATED_AT] + i * 8, static_cast<int64_t>(tx.createdAt));
+        put(out, header.offsets[UPDATED_AT] + i * 8, static_cast<int64_t>(tx.updatedAt));
+        out[header.offsets[TYPE] + i] = static_cast<char>(tx.type);
+        out[header.offsets[IS_DELETED] + i] = tx.isDeleted ? 1 : 0;
+        putString(ID, i, tx.id);
+        put(out, header.offsets[CATEGORY_CODE] + i * 4, tx.categoryCode);
+        putString(NOTE, i, tx.note);
+    }
+
+    return out;
+}
+
+Money TransactionSnapshot::amount(size_t row) const {
+    const char* cell = section(AMOUNT) + row * 8;
+    if (formatVersion < 3) {
+        return Money::fromDouble(get<double>(cell));
+    }
+    return Money::fromMinor(get<int64_t>(cell));
+}
+
+TransactionType TransactionSnapshot::type(size_t row) const {
+    return types()[row] == static_cast<uint8_t>(TransactionType::INCOME)
+               ? TransactionType::INCOME : TransactionType::EXPENSE;
+}
+
+time_t TransactionSnapshot::createdAt(size_t row) const {
+    return static_cast<time_t>(get<int64_t>(section(CREATED_AT) + row * 8));
+}
+
+time_t TransactionSnapshot::updatedAt(size_t row) const {
+    return static_cast<time_t>(get<int64_t>(section(UPDATED_AT) + row * 8));
+}
+
+std::string_view TransactionSnapshot::heapString(StringRef ref) const {
+    if (ref.offset > heapSize || ref.length > heapSize - ref.offset) {
+        return std::string_view();
+    }
+    return std::string_view(section(HEAP) + ref.offset, ref.length);
+}
+
+std::string_view TransactionSnapshot::string(Column column, size_t row) const {
+    return heapString(get<StringRef>(section(column) + row * sizeof(StringRef)));
+}
+
+std::string_view TransactionSnapshot::category(uint32_t code) const {
+    if (code >= categories) {
+        return std::string_view();
+    }
+    return heapString(get<StringRef>(section(CATEGORIES) + code * sizeof(StringRef)));
+}
+
+uint32_t TransactionSnapshot::categoryCode(size_t row) const {
+    if (formatVersion == 1) {
+        return std::numeric_limits<uint32_t>::max();
+    }
+    return get<uint32_t>(section(CATEGORY_CODE) + row * 4);
+}
+
+std::string_view TransactionSnapshot::categoryId(size_t row) const {
+    return formatVersion == 1 ? string(CATEGORY_CODE, row) : category(categoryCode(row));
+}
+
+Transaction TransactionSnapshot::row(size_t row) const {
+    Transaction tx;
+    tx.id = id(row);
+    tx.amount = amount(row);
+    tx.type = type(row);
+    tx.date = date(row);
+    tx.categoryId = categoryId(row);
+    tx.note = note(row);
+    tx.createdAt = createdAt(row);
+    tx.updatedAt = updatedAt(row);
+    tx.isDeleted = isDeleted(row);
+    return tx;
+}
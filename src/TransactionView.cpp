@@ -0,0 +1,426 @@
+#include "../include/storage/TransactionView.h"
+#include "../include/util/ThreadPool.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+const size_t CHUNKS_PER_PARTITION = TransactionView::PARTITION_ROWS / TransactionChunk::ROWS;
+
+// A chunk walks its date order instead of running the kernel when fewer
+// than 1/SPARSE_FRACTION of its rows fall in the range
+const size_t SPARSE_FRACTION = 8;
+
+struct DateBounds {
+    int64_t from;
+    int64_t to;
+
+    DateBounds(time_t _from, time_t _to)
+        : from(_from == 0 ? std::numeric_limits<int64_t>::min() : static_cast<int64_t>(_from)),
+          to(_to == 0 ? std::numeric_limits<int64_t>::max() : static_cast<int64_t>(_to)) {}
+
+    bool contains(int64_t date) const { return date >= from && date <= to; }
+};
+
+// Positions in a sealed chunk's date order whose dates lie within bounds
+std::pair<size_t, size_t> sealedRange(const TransactionChunk& chunk, const DateBounds& bounds) {
+    if (chunk.maxDate < bounds.from || chunk.minDate > bounds.to) {
+        return {0, 0};
+    }
+    auto first = std::partition_point(chunk.byDate.begin(), chunk.byDate.end(), [&](uint16_t slot) {
+        return chunk.columns.date(slot) < bounds.from;
+    });
+    auto last = std::partition_point(first, chunk.byDate.end(), [&](uint16_t slot) {
+        return chunk.columns.date(slot) <= bounds.to;
+    });
+    return {static_cast<size_t>(first - chunk.byDate.begin()),
+            static_cast<size_t>(last - chunk.byDate.begin())};
+}
+
+// (date, slot) order of a chunk's byDate
+struct DateOrder {
+    const TransactionColumns& columns;
+
+    bool operator()(uint16_t a, uint16_t b) const {
+        int64_t dateA = columns.date(a);
+        int64_t dateB = columns.date(b);
+        return dateA != dateB ? dateA < dateB : a < b;
+    }
+};
+
+bool rowMatches(const TransactionColumns& columns, size_t slot, const DateBounds& bounds,
+                TransactionType type) {
+    return !columns.isDeleted(slot) && columns.type(slot) == type && bounds.contains(columns.date(slot));
+}
+
+// Calls sink(slot) for every matching slot of one chunk, or hands the whole
+// chunk to kernel() when a sequential pass is the cheaper plan
+template <typename Sink, typename Kernel>
+void scanChunk(const TransactionChunk& chunk, size_t rows, bool sealed, const DateBounds& bounds,
+               TransactionType type, bool columnar, Sink sink, Kernel kernel) {
+    if (sealed) {
+        auto range = sealedRange(chunk, bounds);
+        if ((range.second - range.first) * SPARSE_FRACTION < rows) {
+            for (size_t i = range.first; i < range.second; ++i) {
+                if (rowMatches(chunk.columns, chunk.byDate[i], bounds, type)) {
+                    sink(chunk.byDate[i]);
+                }
+            }
+            return;
+        }
+    }
+
+    if (columnar) {
+        kernel();
+        return;
+    }
+    for (size_t slot = 0; slot < rows; ++slot) {
+        if (rowMatches(chunk.columns, slot, bounds, type)) {
+            sink(slot);
+        }
+    }
+}
+
+// Packs a timestamp into a record field, or returns false if it does not fit
+bool packTime(time_t time, int32_t& packed) {
+    int64_t offset = static_cast<int64_t>(time) - TransactionRecord::TIME_BASE;
+    if (offset <= TransactionRecord::WIDE || offset > std::numeric_limits<int32_t>::max()) {
+        return false;
+    }
+    packed = static_cast<int32_t>(offset);
+    return true;
+}
+
+const WideTimes& wideTimesOf(const TransactionChunk& chunk, size_t slot) {
+    return *std::lower_bound(chunk.wideTimes.begin(), chunk.wideTimes.end(), slot,
+                             [](const WideTimes& entry, size_t target) { return entry.slot < target; });
+}
+
+bool satisfiesAt(const TransactionChunk& chunk, size_t slot, const RowConditions& conditions) {
+    const TransactionColumns& columns = chunk.columns;
+    if (columns.isDeleted(slot)) return false;
+    if (conditions.categoryCode != UINT32_MAX && columns.categoryCode(slot) != conditions.categoryCode) {
+        return false;
+    }
+    if (conditions.type && columns.type(slot) != *conditions.type) return false;
+    int64_t date = columns.date(slot);
+    if (conditions.dateFrom > 0 && date < conditions.dateFrom) return false;
+    if (conditions.dateTo > 0 && date > conditions.dateTo) return false;
+    if (conditions.noteTerms) {
+        std::string_view note = chunk.note(slot);
+        for (const auto& term : *conditions.noteTerms) {
+            if (note.find(term) == std::string_view::npos) return false;
+        }
+    }
+    return true;
+}
+
+// Calls visitor with every live row among a chunk's slots that satisfies
+// conditions (when given), rebuilding them one at a time into the same
+// Transaction
+template <typename Slots>
+void visitRows(const TransactionChunk& chunk, const Slots& slots,
+               const std::vector<std::string>& categoryIds, const RowConditions* conditions,
+               RowFields fields, Transaction& tx, const TransactionVisitor& visitor) {
+    for (size_t slot : slots) {
+        if (conditions ? !satisfiesAt(chunk, slot, *conditions) : chunk.columns.isDeleted(slot)) continue;
+        if (fields == RowFields::ALL) {
+            chunk.load(slot, categoryIds[chunk.columns.categoryCode(slot)], tx);
+        } else {
+            chunk.loadNumeric(slot, tx);
+        }
+        visitor(tx);
+    }
+}
+
+// The slots [0, count)
+struct SlotRange {
+    struct Iterator {
+        size_t slot;
+        size_t operator*() const { return slot; }
+        Iterator& operator++() { ++slot; return *this; }
+        bool operator!=(const Iterator& other) const { return slot != other.slot; }
+    };
+    size_t count;
+    Iterator begin() const { return Iterator{0}; }
+    Iterator end() const { return Iterator{count}; }
+};
+
+} // namespace
+
+void TransactionChunk::store(size_t slot, const Transaction& tx, uint32_t categoryCode,
+                             CompactText id, CompactText note) {
+    columns.set(slot, tx, categoryCode);
+    TransactionRecord& record = records[slot];
+    record.id = id;
+    record.note = note;
+
+    auto wide = std::lower_bound(wideTimes.begin(), wideTimes.end(), slot,
+                                 [](const WideTimes& entry, size_t target) { return entry.slot < target; });
+    bool hadWide = wide != wideTimes.end() && wide->slot == slot;
+    if (packTime(tx.createdAt, record.createdAt) && packTime(tx.updatedAt, record.updatedAt)) {
+        if (hadWide) {
+            wideTimes.erase(wide);
+        }
+        return;
+    }
+    record.createdAt = TransactionRecord::WIDE;
+    record.updatedAt = TransactionRecord::WIDE;
+    WideTimes times{static_cast<uint16_t>(slot), static_cast<int64_t>(tx.createdAt),
+                    static_cast<int64_t>(tx.updatedAt)};
+    if (hadWide) {
+        *wide = times;
+    } else {
+        wideTimes.insert(wide, times);
+    }
+}
+
+time_t TransactionChunk::createdAt(size_t slot) const {
+    int32_t packed = records[slot].createdAt;
+    if (packed == TransactionRecord::WIDE) {
+        return static_cast<time_t>(wideTimesOf(*this, slot).createdAt);
+    }
+    return static_cast<time_t>(TransactionRecord::TIME_BASE + packed);
+}
+
+time_t TransactionChunk::updatedAt(size_t slot) const {
+    int32_t packed = records[slot].updatedAt;
+    if (packed == TransactionRecord::WIDE) {
+        return static_cast<time_t>(wideTimesOf(*this, slot).updatedAt);
+    }
+    return static_cast<time_t>(TransactionRecord::TIME_BASE + packed);
+}
+
+void TransactionChunk::load(size_t slot, const std::string& categoryId, Transaction& out) const {
+    std::string_view text = id(slot);
+    out.id.assign(text.data(), text.size());
+    out.categoryId = categoryId;
+    text = note(slot);
+    out.note.assign(text.data(), text.size());
+    loadNumeric(slot, out);
+}
+
+void TransactionChunk::loadNumeric(size_t slot, Transaction& out) const {
+    out.amount = columns.amount(slot);
+    out.type = columns.type(slot);
+    out.date = static_cast<time_t>(columns.date(slot));
+    out.categoryCode = columns.categoryCode(slot);
+    out.createdAt = createdAt(slot);
+    out.updatedAt = updatedAt(slot);
+    out.isDeleted = columns.isDeleted(slot);
+}
+
+size_t TransactionChunk::memoryBytes() const {
+    return sizeof(TransactionChunk) + columns.memoryBytes() + wideTimes.capacity() * sizeof(WideTimes);
+}
+
+void TransactionChunk::seal() {
+    for (size_t slot = 0; slot < ROWS; ++slot) {
+        byDate[slot] = static_cast<uint16_t>(slot);
+    }
+    std::sort(byDate.begin(), byDate.end(), DateOrder{columns});
+    minDate = columns.date(byDate.front());
+    maxDate = columns.date(byDate.back());
+}
+
+void TransactionChunk::reseal(size_t slot) {
+    DateOrder before{columns};
+    auto entry = std::find(byDate.begin(), byDate.end(), static_cast<uint16_t>(slot));
+    std::rotate(entry, entry + 1, byDate.end());   // the slot is now last
+    auto position = std::partition_point(byDate.begin(), byDate.end() - 1,
+                                         [&](uint16_t other) { return before(other, byDate.back()); });
+    std::rotate(position, byDate.end() - 1, byDate.end());
+    minDate = columns.date(byDate.front());
+    maxDate = columns.date(byDate.back());
+}
+
+TransactionView::TransactionView(std::shared_ptr<const Directory> _segments,
+                                 std::shared_ptr<const std::vector<std::string>> _categoryIds,
+                                 std::shared_ptr<const TextArena> _text, size_t _rowCount,
+                                 size_t liveCount, uint64_t version, bool _columnar)
+    : segments(std::move(_segments)), categoryIds(std::move(_categoryIds)), text(std::move(_text)),
+      rowCount(_rowCount), live(liveCount), versionNumber(version), columnar(_columnar) {}
+
+size_t TransactionView::chunkCount() const {
+    return (rowCount + TransactionChunk::ROWS - 1) / TransactionChunk::ROWS;
+}
+
+size_t TransactionView::rowsIn(size_t chunk) const {
+    return std::min(TransactionChunk::ROWS, rowCount - chunk * TransactionChunk::ROWS);
+}
+
+Transaction TransactionView::at(size_t slot) const {
+    Transaction tx;
+    load(slot, tx);
+    return tx;
+}
+
+void TransactionView::load(size_t slot, Transaction& out) const {
+    const TransactionChunk& chunk = chunkAt(slot / TransactionChunk::ROWS);
+    size_t offset = slot % TransactionChunk::ROWS;
+    chunk.load(offset, (*categoryIds)[chunk.columns.categoryCode(offset)], out);
+}
+
+bool TransactionView::isDeleted(size_t slot) const {
+    return chunkAt(slot / TransactionChunk::ROWS).columns.isDeleted(slot % TransactionChunk::ROWS);
+}
+
+bool TransactionView::satisfies(size_t slot, const RowConditions& conditions) const {
+    return satisfiesAt(chunkAt(slot / TransactionChunk::ROWS), slot % TransactionChunk::ROWS, conditions);
+}
+
+void TransactionView::forEach(const TransactionVisitor& visitor, RowFields fields) const {
+    Transaction tx;
+    for (size_t chunk = 0; chunk < chunkCount(); ++chunk) {
+        visitRows(chunkAt(chunk), SlotRange{rowsIn(chunk)}, *categoryIds, nullptr, fields, tx, visitor);
+    }
+}
+
+void TransactionView::forEach(const RowConditions& conditions, const TransactionVisitor& visitor) const {
+    Transaction tx;
+    for (size_t chunk = 0; chunk < chunkCount(); ++chunk) {
+        visitRows(chunkAt(chunk), SlotRange{rowsIn(chunk)}, *categoryIds, &conditions, RowFields::ALL,
+                  tx, visitor);
+    }
+}
+
+size_t TransactionView::partitionCount() const {
+    return (rowCount + PARTITION_ROWS - 1) / PARTITION_ROWS;
+}
+
+void TransactionView::forEachInPartition(size_t partition, const TransactionVisitor& visitor,
+                                         RowFields fields) const {
+    Transaction tx;
+    size_t end = std::min((partition + 1) * CHUNKS_PER_PARTITION, chunkCount());
+    for (size_t chunk = partition * CHUNKS_PER_PARTITION; chunk < end; ++chunk) {
+        visitRows(chunkAt(chunk), SlotRange{rowsIn(chunk)}, *categoryIds, nullptr, fields, tx, visitor);
+    }
+}
+
+void TransactionView::forEachInDateRange(time_t from, time_t to, const TransactionVisitor& visitor,
+                                         RowFields fields) const {
+    scanDateRange(from, to, nullptr, fields, visitor);
+}
+
+void TransactionView::forEachInDateRange(const RowConditions& conditions,
+                                         const TransactionVisitor& visitor) const {
+    scanDateRange(conditions.dateFrom, conditions.dateTo, &conditions, RowFields::ALL, visitor);
+}
+
+void TransactionView::scanDateRange(time_t from, time_t to, const RowConditions* conditions,
+                                    RowFields fields, const TransactionVisitor& visitor) const {
+    DateBounds bounds(from, to);
+    std::vector<uint16_t> slots;
+    Transaction tx;
+    for (size_t chunk = 0; chunk < chunkCount(); ++chunk) {
+        const TransactionChunk& block = chunkAt(chunk);
+        size_t rows = rowsIn(chunk);
+        if (rows == TransactionChunk::ROWS) {
+            // Sealed: take the date range, then restore storage order
+            auto range = sealedRange(block, bounds);
+            slots.assign(block.byDate.begin() + range.first, block.byDate.begin() + range.second);
+            std::sort(slots.begin(), slots.end());
+        } else {
+            slots.clear();
+            for (size_t slot = 0; slot < rows; ++slot) {
+                if (bounds.contains(block.columns.date(slot))) {
+                    slots.push_back(static_cast<uint16_t>(slot));
+                }
+            }
+        }
+        visitRows(block, slots, *categoryIds, conditions, fields, tx, visitor);
+    }
+}
+
+size_t TransactionView::countInDateRange(time_t from, time_t to, size_t limit) const {
+    DateBounds bounds(from, to);
+    size_t count = 0;
+    for (size_t chunk = 0; chunk < chunkCount() && count < limit; ++chunk) {
+        const TransactionChunk& block = chunkAt(chunk);
+        size_t rows = rowsIn(chunk);
+        if (rows == TransactionChunk::ROWS) {
+            auto range = sealedRange(block, bounds);
+            count += range.second - range.first;
+        } else {
+            for (size_t slot = 0; slot < rows; ++slot) {
+                count += bounds.contains(block.columns.date(slot));
+            }
+        }
+    }
+    return std::min(count, limit);
+}
+
+ColumnSum TransactionView::sumAmounts(time_t from, time_t to, TransactionType type,
+                                      ThreadPool* pool) const {
+    DateBounds bounds(from, to);
+    std::vector<ColumnSum> partials(partitionCount());
+    ThreadPool::run(pool, partials.size(), [&](size_t partition) {
+        ColumnSum& partial = partials[partition];
+        size_t end = std::min((partition + 1) * CHUNKS_PER_PARTITION, chunkCount());
+        for (size_t chunk = partition * CHUNKS_PER_PARTITION; chunk < end; ++chunk) {
+            const TransactionChunk& block = chunkAt(chunk);
+            size_t rows = rowsIn(chunk);
+            ColumnSum sum;
+            scanChunk(block, rows, rows == TransactionChunk::ROWS, bounds, type, columnar,
+                      [&](size_t slot) {
+                          sum.sum += block.columns.amount(slot);
+                          ++sum.count;
+                      },
+                      [&] { sum = block.columns.sumAmounts(from, to, type, 0, rows); });
+            partial.sum += sum.sum;
+            partial.count += sum.count;
+        }
+    });
+
+    ColumnSum result;
+    for (const auto& partial : partials) {
+        result.sum += partial.sum;
+        result.count += partial.count;
+    }
+    return result;
+}
+
+std::vector<ColumnSum> TransactionView::sumByCategoryCode(time_t from, time_t to,
+                                                         TransactionType type,
+                                                         ThreadPool* pool) const {
+    DateBounds bounds(from, to);
+    std::vector<std::vector<ColumnSum>> partials(partitionCount());
+    ThreadPool::run(pool, partials.size(), [&](size_t partition) {
+        std::vector<ColumnSum>& byCode = partials[partition];
+        byCode.resize(categoryIds->size());
+        size_t end = std::min((partition + 1) * CHUNKS_PER_PARTITION, chunkCount());
+        for (size_t chunk = partition * CHUNKS_PER_PARTITION; chunk < end; ++chunk) {
+            const TransactionChunk& block = chunkAt(chunk);
+            size_t rows = rowsIn(chunk);
+            scanChunk(block, rows, rows == TransactionChunk::ROWS, bounds, type, columnar,
+                      [&](size_t slot) {
+                          ColumnSum& bucket = byCode[block.columns.categoryCode(slot)];
+                          bucket.sum += block.columns.amount(slot);
+                          ++bucket.count;
+                      },
+                      [&] { block.columns.sumByCategory(from, to, type, 0, rows, byCode); });
+        }
+    });
+
+    std::vector<ColumnSum> byCode(categoryIds->size());
+    for (const auto& partial : partials) {
+        for (uint32_t code = 0; code < partial.size(); ++code) {
+            byCode[code].sum += partial[code].sum;
+            byCode[code].count += partial[code].count;
+        }
+    }
+    return byCode;
+}
+
+std::map<std::string, ColumnSum> TransactionView::sumByCategory(time_t from, time_t to,
+                                                                TransactionType type,
+                                                                ThreadPool* pool) const {
+    std::vector<ColumnSum> byCode = sumByCategoryCode(from, to, type, pool);
+    std::map<std::string, ColumnSum> result;
+    for (uint32_t code = 0; code < byCode.size(); ++code) {
+        if (byCode[code].count > 0) {
+            result[(*categoryIds)[code]] = byCode[code];
+        }
+    }
+    return result;
+}
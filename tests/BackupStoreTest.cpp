@@ -0,0 +1,204 @@
+// Checks BackupStore: generations share unchanged chunks, old ones are
+// pruned past the retention count along with the chunks only they used,
+// every kept generation restores byte for byte, a damaged or missing chunk
+// fails the restore, and generation names keep sorting past sequence 999.
+//
+// Build and run from the project root:
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined -pthread tests/BackupStoreTest.cpp $(ls src/*.cpp | grep -v main.cpp) -o backup_store_test
+//   ./backup_store_test
+
+#include "../include/storage/BackupStore.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            ++failures;                                                               \
+            std::fprintf(stderr, "FAIL %s:%d %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                             \
+    } while (0)
+
+using Files = std::map<std::string, std::string>;
+
+std::string readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const fs::path& path, const std::string& content) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+}
+
+Files readDirectory(const fs::path& dir) {
+    Files files;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        files[entry.path().filename().string()] = readFile(entry.path());
+    }
+    return files;
+}
+
+std::string randomBytes(std::mt19937& random, size_t size) {
+    std::string bytes(size, '\0');
+    for (auto& byte : bytes) {
+        byte = static_cast<char>(random());
+    }
+    return bytes;
+}
+
+std::vector<fs::path> chunkFiles(const fs::path& root) {
+    std::vector<fs::path> chunks;
+    for (const auto& entry : fs::recursive_directory_iterator(root / "chunks")) {
+        if (entry.is_regular_file()) {
+            chunks.push_back(entry.path());
+        }
+    }
+    return chunks;
+}
+
+template <typename Operation>
+bool throws(Operation operation) {
+    try {
+        operation();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void testGenerations(const fs::path& base) {
+    fs::path data = base / "data";
+    fs::path root = base / "backup";
+    fs::create_directories(data);
+    std::mt19937 random(11);
+    writeFile(data / "transactions.snap", randomBytes(random, 1 << 20));
+    writeFile(data / "transactions.wal", randomBytes(random, 200 * 1024));
+    writeFile(data / "settings.json", "{ \"currency\": \"CNY\" }");
+
+    BackupStore store(root.string(), 3);
+    std::map<std::string, Files> expected;   // generation -> directory as backed up
+    auto backup = [&] {
+        std::string manifest = store.write(BackupStore::capture(data.string()));
+        std::string generation = fs::path(manifest).stem().string();
+        expected[generation] = readDirectory(data);
+        return store.lastStats();
+    };
+
+    BackupStats first = backup();
+    CHECK(first.files == 3 && first.filesUnchanged == 0);
+    CHECK(first.chunksStored == first.chunks);
+
+    // Appending to the log reads only the log, and stores only its tail
+    std::ofstream(data / "transactions.wal", std::ios::binary | std::ios::app) << randomBytes(random, 4096);
+    BackupStats appended = backup();
+    CHECK(appended.filesUnchanged == 2);
+    CHECK(appended.chunksStored >= 1 && appended.chunksStored <= 2);
+    CHECK(appended.bytesStored < 300 * 1024);
+
+    // An edit in the middle of the snapshot shares the chunks around it
+    std::string snapshot = readFile(data / "transactions.snap");
+    snapshot.replace(snapshot.size() / 2, 100, randomBytes(random, 100));
+    writeFile(data / "transactions.snap", snapshot);
+    BackupStats edited = backup();
+    CHECK(edited.filesUnchanged == 2);
+    CHECK(edited.chunksStored >= 1 && edited.chunksStored <= 2);
+    CHECK(edited.bytesStored < snapshot.size() / 2);
+
+    // Two more generations push the first two past the retention of three,
+    // and the chunks only they referred to go with them
+    writeFile(data / "settings.json", "{ \"currency\": \"USD\" }");
+    backup();
+    writeFile(data / "transactions.snap", randomBytes(random, 512 * 1024));
+    backup();
+    std::vector<std::string> kept = store.generations();
+    CHECK(kept.size() == 3);
+    std::string manifests;
+    for (const auto& generation : kept) {
+        manifests += readFile(root / "manifests" / (generation + ".manifest"));
+    }
+    size_t unreferenced = 0;
+    for (const auto& chunk : chunkFiles(root)) {
+        unreferenced += manifests.find(chunk.filename().string()) == std::string::npos;
+    }
+    CHECK(unreferenced == 0);
+    std::vector<std::string> all;
+    for (const auto& entry : expected) {
+        all.push_back(entry.first);
+    }
+    CHECK(kept == std::vector<std::string>(all.end() - 3, all.end()));
+
+    // Every kept generation restores exactly what was backed up
+    for (const auto& generation : kept) {
+        fs::path target = base / ("restore-" + generation);
+        store.restore(generation, target.string());
+        CHECK(readDirectory(target) == expected[generation]);
+    }
+    CHECK(throws([&] { store.restore(all.front(), (base / "restore-pruned").string()); }));
+
+    // A flipped byte or a missing chunk fails the restore
+    std::vector<fs::path> chunks = chunkFiles(root);
+    std::string damaged = readFile(chunks.front());
+    damaged[damaged.size() / 2] ^= 0x20;
+    writeFile(chunks.front(), damaged);
+    fs::remove(chunks.back());
+    size_t failedRestores = 0;
+    for (const auto& generation : kept) {
+        failedRestores += throws([&] { store.restore(generation, (base / "restore-damaged").string()); });
+    }
+    CHECK(failedRestores > 0);
+}
+
+void testLongSequences(const fs::path& base) {
+    fs::path data = base / "data";
+    fs::path root = base / "backup";
+    fs::create_directories(data);
+    writeFile(data / "settings.json", "{}");
+
+    // Two generations named as if 999 backups had already run in one
+    // second, late enough that new backups continue their sequence
+    BackupStore store(root.string(), 100);
+    std::string manifest = store.write(BackupStore::capture(data.string()));
+    for (const char* sequence : {"998", "999"}) {
+        fs::copy_file(manifest, root / "manifests" / (std::string("29991231-235959-") + sequence + ".manifest"));
+    }
+
+    std::string next = fs::path(store.write(BackupStore::capture(data.string()))).stem().string();
+    std::string after = fs::path(store.write(BackupStore::capture(data.string()))).stem().string();
+    CHECK(next == "29991231-235959-1000");
+    CHECK(after == "29991231-235959-1001");
+
+    std::vector<std::string> generations = store.generations();
+    CHECK(generations.size() == 5);
+    if (generations.size() == 5) {
+        CHECK(generations[2] == "29991231-235959-999");
+        CHECK(generations[3] == next && generations[4] == after);
+    }
+    store.restore(after, (base / "restore").string());
+    CHECK(readFile(base / "restore" / "settings.json") == "{}");
+}
+
+} // namespace
+
+int main() {
+    fs::path base = fs::temp_directory_path() / "backup_store_test";
+    fs::remove_all(base);
+    testGenerations(base / "generations");
+    testLongSequences(base / "sequences");
+    fs::remove_all(base);
+
+    std::printf("failures=%d\n", failures);
+    return failures == 0 ? 0 : 1;
+}
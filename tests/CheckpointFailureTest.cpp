@@ -0,0 +1,155 @@
+// Checks that a checkpoint whose snapshot cannot be written leaves the
+// write-ahead log on disk intact, in both FileStorage write modes. A crash
+// right after the failed checkpoint must still reload every row that had
+// reached the disk. A compaction whose checkpoint fails must say so.
+//
+// Build and run from the project root:
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined -pthread tests/CheckpointFailureTest.cpp $(ls src/*.cpp | grep -v main.cpp) -o checkpoint_failure
+//   ./checkpoint_failure
+
+#include "../include/storage/FileStorage.h"
+#include "../include/storage/TransactionRepository.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            ++failures;                                                               \
+            std::fprintf(stderr, "FAIL %s:%d %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                             \
+    } while (0)
+
+Transaction makeTransaction(int i) {
+    return Transaction("", Money::fromMinor(100 + i), TransactionType::EXPENSE, 1700000000 + i * 3600,
+                       "food", "row " + std::to_string(i));
+}
+
+void run(WriteMode mode, const fs::path& dir) {
+    fs::path crashed = dir.string() + "_crashed";
+    fs::remove_all(dir);
+    fs::remove_all(crashed);
+    fs::create_directories(dir);
+    fs::path log = dir / "transactions.wal";
+    fs::path snapshot = dir / "transactions.snap";
+    // A directory where the snapshot's temp file goes makes its write fail
+    fs::path blocker = dir / "transactions.snap.tmp";
+
+    {
+        auto storage = std::make_shared<FileStorage>(dir.string(), mode);
+        storage->setFlushDelay(std::chrono::seconds(10));
+        TransactionRepository repo(storage);
+        repo.setCheckpointMinBytes(1 << 20);
+
+        for (int i = 0; i < 10; ++i) {
+            repo.add(makeTransaction(i));
+        }
+        storage->flush();
+        uintmax_t logBytes = fs::file_size(log);
+        CHECK(logBytes > 0);
+
+        // In write-behind mode these appends are still queued when the
+        // checkpoint saves the snapshot and truncates the log
+        for (int i = 10; i < 15; ++i) {
+            repo.add(makeTransaction(i));
+        }
+
+        fs::create_directory(blocker);
+        bool threw = false;
+        try {
+            repo.checkpoint();
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(!fs::exists(snapshot));
+        CHECK(fs::file_size(log) >= logBytes);
+
+        // The disk as a crash at this point would leave it
+        fs::copy(dir, crashed, fs::copy_options::recursive);
+        fs::remove_all(crashed / "transactions.snap.tmp");
+
+        // Once the snapshot can be written, the next checkpoint succeeds
+        fs::remove(blocker);
+        repo.add(makeTransaction(15));
+        repo.checkpoint();
+        CHECK(fs::exists(snapshot));
+        CHECK(fs::file_size(log) == 0);
+    }
+
+    size_t recovered = TransactionRepository(std::make_shared<FileStorage>(crashed.string())).count();
+    CHECK(recovered >= 10);
+    CHECK(TransactionRepository(std::make_shared<FileStorage>(dir.string())).count() == 16);
+    std::printf("%s: %zu rows recovered after the failed checkpoint\n",
+                mode == WriteMode::BEHIND ? "write-behind" : "write-through", recovered);
+
+    fs::remove_all(dir);
+    fs::remove_all(crashed);
+}
+
+template <typename Operation>
+bool throws(Operation operation) {
+    try {
+        operation();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void testCompaction(const fs::path& dir) {
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    fs::path blocker = dir / "transactions.snap.tmp";
+    {
+        auto storage = std::make_shared<FileStorage>(dir.string(), WriteMode::THROUGH);
+        TransactionRepository repo(storage);
+        repo.setCompactionPolicy(CompactionPolicy{0, 1.0, 1000000});   // never automatic
+        std::vector<std::string> ids;
+        for (int i = 0; i < 20; ++i) {
+            ids.push_back(repo.add(makeTransaction(i)).id);
+        }
+        for (int i = 0; i < 10; ++i) {
+            repo.remove(ids[i]);
+        }
+
+        fs::create_directory(blocker);
+        CHECK(throws([&] { repo.compact(); }));
+        CHECK(repo.count() == 10);
+        CHECK(repo.memoryUsage().tombstones == 0);
+
+        // Compaction triggered by a removal does not fail the removal
+        repo.remove(ids[10]);
+        CHECK(!throws([&] { repo.setCompactionPolicy(CompactionPolicy{0, 0.0, 1}); }));
+        CHECK(repo.count() == 9);
+        CHECK(TransactionRepository(std::make_shared<FileStorage>(dir.string())).count() == 9);
+
+        fs::remove(blocker);
+        repo.remove(ids[11]);
+        CHECK(repo.memoryUsage().tombstones == 0);
+    }
+    CHECK(TransactionRepository(std::make_shared<FileStorage>(dir.string())).count() == 8);
+    fs::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+    fs::path base = fs::temp_directory_path() / "checkpoint_failure_test";
+    run(WriteMode::THROUGH, base.string() + "_through");
+    run(WriteMode::BEHIND, base.string() + "_behind");
+    testCompaction(base.string() + "_compaction");
+    std::printf("failures=%d\n", failures);
+    return failures == 0 ? 0 : 1;
+}
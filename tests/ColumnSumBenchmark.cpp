@@ -0,0 +1,118 @@
+// Times a filtered amount sum three ways over the same rows: a loop over
+// whole Transaction objects, as the services ran before the columnar store,
+// and TransactionColumns::sumAmounts with its scalar and AVX2 kernels.
+// Every way must give the same sum and row count.
+//
+// Build and run from the project root:
+//   g++ -std=c++17 -O2 -pthread tests/ColumnSumBenchmark.cpp $(ls src/*.cpp | grep -v main.cpp) -o column_sum_benchmark
+//   ./column_sum_benchmark [rows]   # default 2000000
+
+#include "../include/storage/TransactionColumns.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const time_t BASE_DATE = 1700000000;
+const time_t SPAN = 365 * 86400;
+const int REPEATS = 5;
+
+struct Query {
+    const char* name;
+    time_t from;
+    time_t to;
+    TransactionType type;
+};
+
+// Best of REPEATS, in milliseconds
+double bestMilliseconds(const std::function<ColumnSum()>& run, ColumnSum& result) {
+    double best = 0;
+    for (int i = 0; i < REPEATS; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        result = run();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+ColumnSum sumRows(const std::vector<Transaction>& rows, const Query& query) {
+    ColumnSum result;
+    for (const auto& tx : rows) {
+        if (tx.isDeleted || tx.type != query.type || (query.from != 0 && tx.date < query.from) ||
+            (query.to != 0 && tx.date > query.to)) {
+            continue;
+        }
+        result.sum += tx.amount;
+        ++result.count;
+    }
+    return result;
+}
+
+bool sameSum(const ColumnSum& a, const ColumnSum& b) {
+    return a.sum == b.sum && a.count == b.count;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+
+    std::mt19937 random(42);
+    std::vector<Transaction> transactions;
+    transactions.reserve(rows);
+    TransactionColumns columns(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        uint32_t category = random() % 16;
+        transactions.emplace_back("t" + std::to_string(i), Money::fromMinor(100 + random() % 100000),
+                                  random() % 3 ? TransactionType::EXPENSE : TransactionType::INCOME,
+                                  BASE_DATE + random() % SPAN, "c" + std::to_string(category),
+                                  "note " + std::to_string(i));
+        transactions.back().isDeleted = random() % 20 == 0;
+        columns.set(i, transactions.back(), category);
+    }
+
+    TransactionColumns::setScalarOnly(false);
+    bool avx2 = std::string(TransactionColumns::kernelName()) == "avx2";
+    const Query queries[] = {
+        {"all expenses", 0, 0, TransactionType::EXPENSE},
+        {"one month of income", BASE_DATE + 90 * 86400, BASE_DATE + 120 * 86400, TransactionType::INCOME},
+    };
+
+    int mismatches = 0;
+    std::printf("%zu rows, %d runs each, best time in ms\n", rows, REPEATS);
+    std::printf("%-22s %12s %12s %12s\n", "query", "objects", "scalar", avx2 ? "avx2" : "avx2 (n/a)");
+    for (const Query& query : queries) {
+        ColumnSum aos, scalar, vector;
+        double aosMs = bestMilliseconds([&] { return sumRows(transactions, query); }, aos);
+
+        TransactionColumns::setScalarOnly(true);
+        double scalarMs = bestMilliseconds(
+            [&] { return columns.sumAmounts(query.from, query.to, query.type, 0, rows); }, scalar);
+        TransactionColumns::setScalarOnly(false);
+
+        double vectorMs = 0;
+        if (avx2) {
+            vectorMs = bestMilliseconds(
+                [&] { return columns.sumAmounts(query.from, query.to, query.type, 0, rows); }, vector);
+        } else {
+            vector = scalar;
+        }
+
+        std::printf("%-22s %12.1f %12.1f %12.1f\n", query.name, aosMs, scalarMs, vectorMs);
+        if (!sameSum(aos, scalar) || !sameSum(aos, vector)) {
+            ++mismatches;
+            std::fprintf(stderr, "%s: rows %lld/%zu, scalar %lld/%zu, avx2 %lld/%zu\n", query.name,
+                         static_cast<long long>(aos.sum.minorUnits()), aos.count,
+                         static_cast<long long>(scalar.sum.minorUnits()), scalar.count,
+                         static_cast<long long>(vector.sum.minorUnits()), vector.count);
+        }
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+// Times getById, update and remove as the ledger grows. With the id hash
+// index each stays flat from ten thousand to a million rows; a linear scan
+// would grow a hundredfold.
+//
+// Build and run from the project root:
+//   g++ -std=c++17 -O2 -pthread tests/IdLookupBenchmark.cpp $(ls src/*.cpp | grep -v main.cpp) -o id_lookup_benchmark
+//   ./id_lookup_benchmark [rows...]   # default 10000 100000 1000000
+
+#include "../include/storage/IStorage.h"
+#include "../include/storage/TransactionRepository.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Accepts every write and keeps nothing, so only the in-memory work is timed
+class NullStorage : public IStorage {
+public:
+    void save(const std::string&, const std::string&) override {}
+    void append(const std::string&, const std::string&) override {}
+    std::string load(const std::string&) override { return ""; }
+    std::string backup() override { return ""; }
+    bool exists(const std::string&) override { return false; }
+    void remove(const std::string&) override {}
+};
+
+const size_t OPERATIONS = 2000;
+
+template <typename Operation>
+double nanosecondsPerCall(size_t calls, Operation operation) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < calls; ++i) {
+        operation(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / calls;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i) {
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+    }
+    if (sizes.empty()) {
+        sizes = {10000, 100000, 1000000};
+    }
+
+    std::printf("%10s %14s %14s %14s\n", "rows", "getById ns", "update ns", "remove ns");
+    for (size_t rows : sizes) {
+        TransactionRepository repo(std::make_shared<NullStorage>());
+        std::mt19937 random(42);
+        std::vector<Transaction> seed;
+        seed.reserve(rows);
+        for (size_t i = 0; i < rows; ++i) {
+            seed.emplace_back("", Money::fromMinor(100 + random() % 100000), TransactionType::EXPENSE,
+                              1700000000 + random() % (365 * 86400), "c" + std::to_string(random() % 16),
+                              "note " + std::to_string(i));
+        }
+        std::vector<Transaction> added = repo.addMany(seed);
+        seed.clear();
+
+        // Distinct rows spread over the whole ledger
+        std::vector<std::string> ids;
+        for (size_t i = 0; i < OPERATIONS; ++i) {
+            std::swap(added[i], added[i + random() % (added.size() - i)]);
+            ids.push_back(added[i].id);
+        }
+        added.clear();
+
+        size_t found = 0;
+        double lookup = nanosecondsPerCall(OPERATIONS, [&](size_t i) {
+            found += repo.getById(ids[i]).amount.minorUnits() > 0;
+        });
+        double update = nanosecondsPerCall(OPERATIONS, [&](size_t i) {
+            Transaction tx = repo.getById(ids[i]);
+            tx.amount += Money::fromMinor(1);
+            repo.update(tx);
+        });
+        double remove = nanosecondsPerCall(OPERATIONS, [&](size_t i) { repo.remove(ids[i]); });
+
+        std::printf("%10zu %14.0f %14.0f %14.0f\n", rows, lookup, update, remove);
+        if (found != OPERATIONS) {
+            std::fprintf(stderr, "lookups found %zu of %zu rows\n", found, OPERATIONS);
+            return 1;
+        }
+    }
+    return 0;
+}
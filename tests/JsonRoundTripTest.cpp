@@ -0,0 +1,208 @@
+// Exports a ledger to a JSON file and imports it into an empty one, checking
+// that every field survives (notes include quotes, escapes, control bytes,
+// CJK text and emoji), that tiny read buffers parse the same, and that bad
+// records are rejected one by one with their index. Prints export, parse-only
+// and import throughput.
+//
+// Build and run from the project root:
+//   g++ -std=c++17 -O2 -pthread tests/JsonRoundTripTest.cpp $(ls src/*.cpp | grep -v main.cpp) -o json_round_trip
+//   ./json_round_trip [rows]   # default 200000
+
+#include "../include/services/ImportExportService.h"
+#include "../include/storage/IStorage.h"
+#include "../include/storage/InputSource.h"
+#include "../include/storage/JsonReader.h"
+#include "../include/storage/OutputSink.h"
+#include "../include/storage/TransactionRepository.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            ++failures;                                                               \
+            std::fprintf(stderr, "FAIL %s:%d %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                             \
+    } while (0)
+
+// Accepts every write and keeps nothing, so only import work is timed
+class NullStorage : public IStorage {
+public:
+    void save(const std::string&, const std::string&) override {}
+    void append(const std::string&, const std::string&) override {}
+    std::string load(const std::string&) override { return ""; }
+    std::string backup() override { return ""; }
+    bool exists(const std::string&) override { return false; }
+    void remove(const std::string&) override {}
+};
+
+// Consumes events without building anything
+class NullHandler : public JsonHandler {
+public:
+    bool startObject() override { return true; }
+    bool endObject() override { return true; }
+    bool startArray() override { return true; }
+    bool endArray() override { return true; }
+    bool key(std::string_view) override { return true; }
+    bool string(std::string_view) override { return true; }
+    bool number(std::string_view) override { return true; }
+    bool boolean(bool) override { return true; }
+    bool null() override { return true; }
+};
+
+const std::string NOTES[] = {
+    "lunch",
+    "say \"hi\" \\ back\\slash",
+    "tab\there\nnew line\r",
+    std::string("\x01\x1f control\0nul", 14),
+    "午饭 咖啡",
+    "emoji \xF0\x9F\x8D\x9C and \xE2\x82\xAC",
+    "",
+};
+
+std::shared_ptr<TransactionRepository> makeLedger(size_t rows) {
+    auto repo = std::make_shared<TransactionRepository>(std::make_shared<NullStorage>());
+    std::mt19937 random(42);
+    std::vector<Transaction> seed;
+    seed.reserve(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        std::string note = NOTES[i % (sizeof(NOTES) / sizeof(NOTES[0]))];
+        note += " #" + std::to_string(i);
+        seed.emplace_back("", Money::fromMinor(1 + random() % 10000000),
+                          random() % 3 ? TransactionType::EXPENSE : TransactionType::INCOME,
+                          1600000000 + random() % (5 * 365 * 86400), "c" + std::to_string(random() % 40),
+                          note);
+    }
+    repo->addMany(seed);
+    return repo;
+}
+
+bool sameRows(const TransactionRepository& expected, const TransactionRepository& actual) {
+    std::unordered_map<std::string, Transaction> byId;
+    for (auto& tx : actual.getAll()) {
+        byId.emplace(tx.id, tx);
+    }
+    size_t matched = 0;
+    expected.forEach([&](const Transaction& tx) {
+        auto it = byId.find(tx.id);
+        if (it != byId.end() && it->second.amount == tx.amount && it->second.type == tx.type &&
+            it->second.date == tx.date && it->second.categoryId == tx.categoryId &&
+            it->second.note == tx.note) {
+            ++matched;
+        }
+    });
+    return matched == expected.count() && byId.size() == expected.count();
+}
+
+double seconds(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void testSmallBuffers() {
+    auto source = makeLedger(300);
+    std::string json = ImportExportService(source).exportToJSON();
+    for (size_t bufferSize : {1, 2, 3, 5, 7, 64}) {
+        std::istringstream in(json);
+        InputSource input(in, bufferSize);
+        auto copy = std::make_shared<TransactionRepository>(std::make_shared<NullStorage>());
+        ImportResult result = ImportExportService(copy).importFromJSON(input);
+        CHECK(result.success);
+        CHECK(result.importedCount == 300 && result.rejectedCount == 0);
+        CHECK(sameRows(*source, *copy));
+    }
+}
+
+void testRecordErrors() {
+    std::string json = "[\n"
+                       "  { \"id\": \"a\", \"amount\": 1.50, \"type\": \"EXPENSE\", \"date\": 1700000000 },\n"
+                       "  { \"id\": \"b\", \"type\": \"EXPENSE\", \"date\": 1700000000 },\n"
+                       "  { \"id\": \"c\", \"amount\": 2, \"type\": \"LOAN\", \"date\": 1700000000 },\n"
+                       "  { \"id\": \"a\", \"amount\": 3, \"type\": \"INCOME\", \"date\": 1700000000 },\n"
+                       "  { \"id\": \"d\", \"amount\": 4, \"type\": \"INCOME\", \"date\": 1700000000,"
+                       " \"extra\": [1, {\"x\": null}] }\n"
+                       "]";
+    auto repo = std::make_shared<TransactionRepository>(std::make_shared<NullStorage>());
+    ImportResult result = ImportExportService(repo).importFromJSON(json);
+    CHECK(result.success);
+    CHECK(result.importedCount == 2);
+    CHECK(result.rejectedCount == 3);
+    CHECK(result.recordErrors.size() == 3);
+    if (result.recordErrors.size() == 3) {
+        CHECK(result.recordErrors[0].record == 1);
+        CHECK(result.recordErrors[1].record == 2);
+        CHECK(result.recordErrors[2].record == 3);
+    }
+    CHECK(repo->count() == 2);
+    CHECK(repo->getById("a").amount == Money::fromMinor(150));
+
+    // A syntax error fails the import as a whole
+    CHECK(!ImportExportService(repo).importFromJSON("[ { \"id\": \"e\", ").success);
+}
+
+void testRoundTrip(size_t rows, const fs::path& path) {
+    auto source = makeLedger(rows);
+    ImportExportService exporter(source);
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        OutputSink sink(path.string());
+        exporter.exportToJSON(sink);
+    }
+    double exportSeconds = seconds(start);
+    double megabytes = fs::file_size(path) / 1e6;
+
+    start = std::chrono::steady_clock::now();
+    {
+        InputSource input(path.string());
+        JsonReader reader(input);
+        NullHandler handler;
+        CHECK(reader.parse(handler));
+    }
+    double parseSeconds = seconds(start);
+
+    auto copy = std::make_shared<TransactionRepository>(std::make_shared<NullStorage>());
+    start = std::chrono::steady_clock::now();
+    ImportResult result;
+    {
+        InputSource input(path.string());
+        result = ImportExportService(copy).importFromJSON(input);
+    }
+    double importSeconds = seconds(start);
+
+    CHECK(result.success);
+    CHECK(result.importedCount == static_cast<int>(rows) && result.rejectedCount == 0);
+    CHECK(sameRows(*source, *copy));
+
+    std::printf("%zu rows, %.1f MB: export %.0f MB/s, parse only %.0f MB/s, import %.0f MB/s\n", rows,
+                megabytes, megabytes / exportSeconds, megabytes / parseSeconds, megabytes / importSeconds);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    fs::path path = fs::temp_directory_path() / "json_round_trip_test.json";
+
+    testSmallBuffers();
+    testRecordErrors();
+    testRoundTrip(rows, path);
+    fs::remove(path);
+
+    std::printf("failures=%d\n", failures);
+    return failures == 0 ? 0 : 1;
+}
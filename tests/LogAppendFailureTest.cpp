@@ -0,0 +1,204 @@
+// Checks that a mutation or batch whose log append fails is reported to the
+// caller and leaves the ledger unchanged, and that a torn record or partial
+// batch left by the failed append does not cost any later write on reload.
+//
+// Build and run from the project root:
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined -pthread tests/LogAppendFailureTest.cpp $(ls src/*.cpp | grep -v main.cpp) -o log_append_failure
+//   ./log_append_failure
+
+#include "../include/storage/IStorage.h"
+#include "../include/storage/TransactionRepository.h"
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            ++failures;                                                               \
+            std::fprintf(stderr, "FAIL %s:%d %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                             \
+    } while (0)
+
+// In-memory storage whose writes can be made to fail. A failing append
+// writes half its bytes first, as a full disk would. appendsBeforeFailure
+// lets that many more appends succeed before failAppends takes effect.
+class FaultyStorage : public IStorage {
+public:
+    std::map<std::string, std::string> values;
+    bool failAppends = false;
+    bool failSaves = false;
+    int appendsBeforeFailure = 0;
+    int appends = 0;
+
+    void save(const std::string& key, const std::string& value) override {
+        if (failSaves) {
+            throw std::runtime_error("save failed: " + key);
+        }
+        values[key] = value;
+    }
+    void append(const std::string& key, const std::string& value) override {
+        ++appends;
+        if (failAppends && appendsBeforeFailure-- <= 0) {
+            values[key] += value.substr(0, value.size() / 2);
+            throw std::runtime_error("append failed: " + key);
+        }
+        values[key] += value;
+    }
+    std::string load(const std::string& key) override {
+        auto it = values.find(key);
+        return it == values.end() ? std::string() : it->second;
+    }
+    std::string backup() override { return ""; }
+    bool exists(const std::string& key) override { return values.count(key) > 0; }
+    void remove(const std::string& key) override { values.erase(key); }
+};
+
+Transaction makeTransaction(int i) {
+    return Transaction("", Money::fromMinor(100 + i), TransactionType::EXPENSE,
+                       1700000000 + static_cast<time_t>(i) * 3600, "food", "row " + std::to_string(i));
+}
+
+template <typename Operation>
+bool throws(Operation operation) {
+    try {
+        operation();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+size_t reloadedCount(const std::shared_ptr<FaultyStorage>& storage) {
+    auto copy = std::make_shared<FaultyStorage>();
+    copy->values = storage->values;
+    return TransactionRepository(copy).count();
+}
+
+void testSingleMutations() {
+    auto storage = std::make_shared<FaultyStorage>();
+    TransactionRepository repo(storage);
+    repo.setCheckpointMinBytes(1 << 20);
+    size_t notified = 0;
+    repo.subscribe([&](const Transaction*, const Transaction&, uint64_t) { ++notified; });
+
+    std::vector<std::string> ids;
+    for (int i = 0; i < 5; ++i) {
+        ids.push_back(repo.add(makeTransaction(i)).id);
+    }
+    uint64_t version = repo.snapshot()->version();
+
+    // Each failed append is reported and changes nothing in memory
+    storage->failAppends = true;
+    CHECK(throws([&] { repo.add(makeTransaction(5)); }));
+    Transaction changed = repo.getById(ids[0]);
+    changed.amount = Money::fromMinor(1);
+    CHECK(throws([&] { repo.update(changed); }));
+    CHECK(throws([&] { repo.remove(ids[1]); }));
+    CHECK(repo.count() == 5);
+    CHECK(repo.getById(ids[0]).amount == Money::fromMinor(100));
+    CHECK(repo.snapshot()->version() == version);
+    CHECK(notified == 5);
+
+    // With the snapshot unwritable too, the damaged log cannot be replaced
+    storage->failAppends = false;
+    storage->failSaves = true;
+    CHECK(throws([&] { repo.add(makeTransaction(6)); }));
+    CHECK(repo.count() == 5);
+
+    // Once storage recovers, the next write replaces the torn log first,
+    // so nothing appended after it is lost on reload
+    storage->failSaves = false;
+    repo.add(makeTransaction(7));
+    repo.update(changed);
+    repo.remove(ids[1]);
+    CHECK(repo.count() == 5);
+    CHECK(reloadedCount(storage) == 5);
+    CHECK(notified == 8);
+}
+
+void stage(TransactionBatch& batch, int first, int count) {
+    for (int i = first; i < first + count; ++i) {
+        Transaction tx = makeTransaction(i);
+        tx.note.append(100, 'x');
+        batch.add(tx);
+    }
+}
+
+void testBatches() {
+    auto storage = std::make_shared<FaultyStorage>();
+    TransactionRepository repo(storage);
+    repo.setCheckpointMinBytes(64 << 20);
+    size_t notified = 0;
+    repo.subscribe([&](const Transaction*, const Transaction&, uint64_t) { ++notified; });
+
+    auto seed = repo.beginBatch();
+    stage(seed, 0, 40000);
+    seed.commit();
+    uint64_t version = repo.snapshot()->version();
+
+    // A batch smaller than the ledger goes to the log in ~1 MiB appends;
+    // the second one fails, leaving an incomplete batch behind
+    auto batch = repo.beginBatch();
+    stage(batch, 40000, 20000);
+    storage->failAppends = true;
+    storage->appendsBeforeFailure = 1;
+    storage->appends = 0;
+    CHECK(throws([&] { batch.commit(); }));
+    CHECK(storage->appends == 2);
+    CHECK(repo.count() == 40000);
+    CHECK(repo.snapshot()->version() == version);
+    CHECK(notified == 40000);
+    CHECK(batch.size() == 20000);
+    // The partial batch was replaced by a snapshot straight away
+    CHECK(reloadedCount(storage) == 40000);
+
+    // Retried once storage recovers, the batch and later writes all reload
+    storage->failAppends = false;
+    CHECK(batch.commit() == 20000);
+    repo.add(makeTransaction(60000));
+    CHECK(repo.count() == 60001);
+    CHECK(reloadedCount(storage) == 60001);
+
+    // With the snapshot unwritable too, the broken log stays in place and
+    // blocks later writes until it can be replaced
+    auto blocked = repo.beginBatch();
+    stage(blocked, 70000, 20000);
+    storage->failAppends = true;
+    storage->appendsBeforeFailure = 1;
+    storage->failSaves = true;
+    CHECK(throws([&] { blocked.commit(); }));
+    storage->failAppends = false;
+    CHECK(throws([&] { repo.add(makeTransaction(90000)); }));
+    CHECK(repo.count() == 60001);
+    storage->failSaves = false;
+    repo.add(makeTransaction(90001));
+    CHECK(reloadedCount(storage) == 60002);
+
+    // A batch as large as the ledger is written as a snapshot; when that
+    // fails the commit fails and nothing changes
+    auto large = repo.beginBatch();
+    stage(large, 100000, 70000);
+    storage->failSaves = true;
+    CHECK(throws([&] { large.commit(); }));
+    CHECK(repo.count() == 60002);
+    storage->failSaves = false;
+    CHECK(large.commit() == 70000);
+    CHECK(reloadedCount(storage) == 130002);
+    CHECK(notified == 130002);
+}
+
+} // namespace
+
+int main() {
+    testSingleMutations();
+    testBatches();
+    std::printf("failures=%d\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// Checks LruCache: the least recently used entry is evicted first, the
+// bytes held never pass the budget, a value larger than the whole budget is
+// not cached and leaves the others alone, and FileStorage's cache stays
+// within its budget while remove() deletes both the file and the cached
+// value, in write-through and write-behind mode.
+//
+// Build and run from the project root:
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined -pthread tests/LruCacheTest.cpp $(ls src/*.cpp | grep -v main.cpp) -o lru_cache_test
+//   ./lru_cache_test
+
+#include "../include/storage/FileStorage.h"
+#include "../include/util/LruCache.h"
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            ++failures;                                                               \
+            std::fprintf(stderr, "FAIL %s:%d %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                             \
+    } while (0)
+
+bool cached(LruCache& cache, const std::string& key) {
+    return cache.find(key) != nullptr;
+}
+
+void testEviction() {
+    LruCache cache(2000);
+    cache.put("a", std::string(400, 'a'));
+    cache.put("b", std::string(400, 'b'));
+    cache.put("c", std::string(400, 'c'));
+    CHECK(cache.stats().entries == 3);
+    CHECK(cached(cache, "a"));   // "b" is now the least recently used
+
+    cache.put("d", std::string(600, 'd'));
+    CHECK(!cached(cache, "b"));
+    CHECK(cached(cache, "a") && cached(cache, "c") && cached(cache, "d"));
+    CacheStats stats = cache.stats();
+    CHECK(stats.evictions == 1);
+    CHECK(stats.bytes <= stats.budget);
+
+    // Replacing a value keeps one entry and marks it most recently used
+    cache.put("c", "new");
+    CHECK(cache.stats().entries == 3);
+    const std::string* value = cache.find("c");
+    CHECK(value != nullptr && *value == "new");
+
+    cache.erase("a");
+    CHECK(!cached(cache, "a"));
+    CHECK(cache.stats().entries == 2);
+}
+
+void testBudget() {
+    LruCache cache(10000);
+    for (int i = 0; i < 200; ++i) {
+        cache.put("key" + std::to_string(i), std::string(100 + i, 'v'));
+        CHECK(cache.stats().bytes <= 10000);
+    }
+    CacheStats stats = cache.stats();
+    CHECK(stats.entries > 0 && stats.entries < 200);
+    CHECK(stats.evictions == 200 - stats.entries);
+    CHECK(cached(cache, "key199"));
+    CHECK(!cached(cache, "key0"));
+
+    // Growing a value in place evicts others rather than passing the budget
+    cache.append("key199", std::string(3000, 'x'));
+    const std::string* grown = cache.find("key199");
+    CHECK(grown != nullptr && grown->size() == 299 + 3000);
+    CHECK(cache.stats().bytes <= 10000);
+
+    // Lowering the budget evicts down to it; zero empties the cache
+    cache.setBudget(5000);
+    CHECK(cache.stats().bytes <= 5000);
+    CHECK(cached(cache, "key199"));
+    cache.setBudget(0);
+    stats = cache.stats();
+    CHECK(stats.entries == 0 && stats.bytes == 0);
+
+    // Erasing everything gives every byte back
+    cache.setBudget(10000);
+    cache.put("x", std::string(500, 'x'));
+    cache.put("y", std::string(500, 'y'));
+    cache.erase("x");
+    cache.erase("y");
+    CHECK(cache.stats().bytes == 0);
+}
+
+void testOversizeValues() {
+    LruCache cache(2000);
+    cache.put("a", std::string(300, 'a'));
+    cache.put("b", std::string(300, 'b'));
+
+    cache.put("huge", std::string(5000, 'h'));
+    CacheStats stats = cache.stats();
+    CHECK(!cached(cache, "huge"));
+    CHECK(stats.entries == 2 && stats.evictions == 0);
+    CHECK(cached(cache, "a") && cached(cache, "b"));
+
+    // An oversize replacement drops the stale value instead of keeping it
+    cache.put("a", std::string(5000, 'a'));
+    CHECK(!cached(cache, "a"));
+    CHECK(cached(cache, "b"));
+
+    // So does an append that would make the value oversize
+    cache.append("b", std::string(5000, 'x'));
+    CHECK(!cached(cache, "b"));
+    CHECK(cache.stats().entries == 0 && cache.stats().bytes == 0);
+
+    // Appending to a key not cached does nothing
+    cache.append("missing", "x");
+    CHECK(!cached(cache, "missing"));
+}
+
+void testFileStorage(const fs::path& dir, WriteMode mode) {
+    fs::remove_all(dir);
+    FileStorage storage(dir.string(), mode);
+    storage.setCacheBudget(64 << 10);
+
+    const std::string value(8 << 10, 'v');
+    for (int i = 0; i < 40; ++i) {
+        storage.save("k" + std::to_string(i) + ".txt", value);
+    }
+    storage.flush();
+    CacheStats stats = storage.cacheStats();
+    CHECK(stats.bytes <= stats.budget);
+    CHECK(stats.entries < 40 && stats.evictions > 0);
+
+    // The oldest values were evicted but still load from disk
+    CHECK(storage.load("k0.txt") == value);
+    CHECK(storage.load("k39.txt") == value);
+
+    CHECK(storage.load("k5.txt") == value);   // cached again
+    storage.remove("k5.txt");
+    CHECK(!fs::exists(dir / "k5.txt"));
+    CHECK(!storage.exists("k5.txt"));
+    CHECK(storage.load("k5.txt").empty());
+    CHECK(storage.exists("k6.txt"));
+
+    // Removed straight after saving, in write-behind mode before the
+    // flusher got to it: the file is gone either way
+    storage.save("late.txt", value);
+    storage.remove("late.txt");
+    storage.flush();
+    CHECK(!fs::exists(dir / "late.txt"));
+    CHECK(storage.load("late.txt").empty());
+
+    // A value larger than the budget is written but not cached
+    const std::string big(128 << 10, 'b');
+    storage.save("big.txt", big);
+    storage.flush();
+    stats = storage.cacheStats();
+    CHECK(stats.bytes <= stats.budget);
+    CHECK(storage.load("big.txt") == big);
+    CHECK(storage.cacheStats().misses == stats.misses + 1);
+}
+
+} // namespace
+
+int main() {
+    testEviction();
+    testBudget();
+    testOversizeValues();
+
+    fs::path base = fs::temp_directory_path() / "lru_cache_test";
+    fs::remove_all(base);
+    testFileStorage(base / "through", WriteMode::THROUGH);
+    testFileStorage(base / "behind", WriteMode::BEHIND);
+    fs::remove_all(base);
+
+    std::printf("failures=%d\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+// Stress test for the concurrent TransactionRepository: writers add, batch,
+// update and remove while readers query views, statistics, search and
+// export. Checks that every view is a consistent, immutable snapshot and
+// that superseded views are freed once nobody holds them.
+//
+// Build and run from the project root, preferably under ThreadSanitizer:
+//   g++ -std=c++17 -O1 -g -fsanitize=thread -pthread tests/RepositoryStressTest.cpp $(ls src/*.cpp | grep -v main.cpp) -o repository_stress
+//   ./repository_stress [writers] [readers] [seconds] [seedRows]
+
+#include "../include/storage/IStorage.h"
+#include "../include/storage/TransactionRepository.h"
+#include "../include/services/ImportExportService.h"
+#include "../include/services/NotificationService.h"
+#include "../include/services/StatisticsService.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const time_t BASE_DATE = 1700000000;
+const time_t SPAN = 120 * 86400;
+
+std::atomic<long> failures(0);
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            ++failures;                                                               \
+            std::fprintf(stderr, "FAIL %s:%d %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                             \
+    } while (0)
+
+class MemoryStorage : public IStorage {
+private:
+    std::mutex mutex;
+    std::map<std::string, std::string> values;
+
+public:
+    void save(const std::string& key, const std::string& value) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        values[key] = value;
+    }
+    void append(const std::string& key, const std::string& value) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        values[key] += value;
+    }
+    std::string load(const std::string& key) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = values.find(key);
+        return it == values.end() ? std::string() : it->second;
+    }
+    std::string backup() override { return ""; }
+    bool exists(const std::string& key) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return values.count(key) > 0;
+    }
+    void remove(const std::string& key) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        values.erase(key);
+    }
+};
+
+Transaction randomTransaction(std::mt19937& random, const std::string& note) {
+    return Transaction("", Money::fromMinor(100 + random() % 100000),
+                       random() % 3 ? TransactionType::EXPENSE : TransactionType::INCOME,
+                       BASE_DATE + random() % SPAN, "c" + std::to_string(random() % 8), note);
+}
+
+// Everything a view shows, folded into a few numbers
+struct ViewDigest {
+    uint64_t version = 0;
+    size_t rows = 0;
+    Money total;
+    size_t idHash = 0;
+
+    bool operator==(const ViewDigest& other) const {
+        return version == other.version && rows == other.rows && total == other.total &&
+               idHash == other.idHash;
+    }
+};
+
+ViewDigest digest(const TransactionView& view) {
+    ViewDigest result;
+    result.version = view.version();
+    view.forEach([&](const Transaction& tx) {
+        ++result.rows;
+        result.total += tx.amount;
+        result.idHash = result.idHash * 31 + std::hash<std::string>()(tx.id) + tx.date;
+    });
+    return result;
+}
+
+void checkView(const TransactionView& view, std::mt19937& random) {
+    // Row scans and column sums agree
+    size_t rows = 0;
+    Money expenses;
+    view.forEach([&](const Transaction& tx) {
+        ++rows;
+        if (tx.type == TransactionType::EXPENSE) {
+            expenses += tx.amount;
+        }
+    });
+    CHECK(rows == view.liveCount());
+    CHECK(view.sumAmounts(0, 0, TransactionType::EXPENSE).sum == expenses);
+
+    // The date range scan returns exactly the rows a full scan filters
+    time_t from = BASE_DATE + random() % SPAN;
+    time_t to = from + random() % (10 * 86400);
+    std::vector<std::string> scanned, ranged;
+    view.forEach([&](const Transaction& tx) {
+        if (tx.date >= from && tx.date <= to) {
+            scanned.push_back(tx.id);
+        }
+    });
+    view.forEachInDateRange(from, to, [&](const Transaction& tx) { ranged.push_back(tx.id); });
+    CHECK(scanned == ranged);
+
+    Money byCategory;
+    for (const auto& entry : view.sumByCategory(from, to, TransactionType::EXPENSE)) {
+        byCategory += entry.second.sum;
+    }
+    CHECK(byCategory == view.sumAmounts(from, to, TransactionType::EXPENSE).sum);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int writers = argc > 1 ? std::atoi(argv[1]) : 2;
+    int readers = argc > 2 ? std::atoi(argv[2]) : 4;
+    int seconds = argc > 3 ? std::atoi(argv[3]) : 3;
+    int seedRows = argc > 4 ? std::atoi(argv[4]) : 5000;
+
+    auto storage = std::make_shared<MemoryStorage>();
+    auto repo = std::make_shared<TransactionRepository>(storage);
+    {
+        std::mt19937 random(7);
+        std::vector<Transaction> seed;
+        for (int i = 0; i < seedRows; ++i) {
+            seed.push_back(randomTransaction(random, "seed note"));
+        }
+        repo->addMany(seed);
+    }
+
+    auto stats = std::make_unique<StatisticsService>(repo, 2);
+    auto notifications = std::make_unique<NotificationService>(repo, std::make_shared<Settings>());
+    auto io = std::make_unique<ImportExportService>(repo);
+
+    // Held for the whole run while every chunk it shares gets rewritten
+    auto pinned = repo->snapshot();
+    ViewDigest pinnedDigest = digest(*pinned);
+
+    std::atomic<bool> stop(false);
+    std::atomic<long> adds(0), updates(0), removes(0), batches(0), reads(0);
+    std::vector<std::vector<std::weak_ptr<const TransactionView>>> released(readers);
+    std::vector<std::thread> threads;
+
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&, w] {
+            // Each writer only updates and removes its own rows, so none of
+            // its operations can fail
+            std::mt19937 random(100 + w);
+            std::vector<std::string> mine;
+            while (!stop) {
+                try {
+                    int op = random() % 20;
+                    if (op < 10 || mine.empty()) {
+                        mine.push_back(repo->add(randomTransaction(random, "writer note")).id);
+                        ++adds;
+                    } else if (op < 11) {
+                        auto batch = repo->beginBatch();
+                        int size = 1 + random() % 2000;
+                        for (int i = 0; i < size; ++i) {
+                            batch.add(randomTransaction(random, "batch"));
+                        }
+                        batch.commit();
+                        ++batches;
+                    } else if (op < 17) {
+                        Transaction tx = repo->getById(mine[random() % mine.size()]);
+                        tx.amount += Money::fromMinor(1);
+                        tx.date = BASE_DATE + random() % SPAN;
+                        repo->update(tx);
+                        ++updates;
+                    } else {
+                        size_t i = random() % mine.size();
+                        repo->remove(mine[i]);
+                        mine[i] = mine.back();
+                        mine.pop_back();
+                        ++removes;
+                    }
+                } catch (const std::exception& e) {
+                    ++failures;
+                    std::fprintf(stderr, "writer %d: %s\n", w, e.what());
+                }
+            }
+        });
+    }
+
+    for (int r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            std::mt19937 random(200 + r);
+            uint64_t lastVersion = 0;
+            while (!stop) {
+                auto view = repo->snapshot();
+                CHECK(view->version() >= lastVersion);
+                lastVersion = view->version();
+
+                switch (random() % 6) {
+                    case 0: {
+                        // A view does not change while writers move on
+                        ViewDigest before = digest(*view);
+                        checkView(*view, random);
+                        CHECK(digest(*view) == before);
+                        break;
+                    }
+                    case 1:
+                        checkView(*view, random);
+                        break;
+                    case 2: {
+                        TransactionFilter filter;
+                        filter.categoryId = "c" + std::to_string(random() % 8);
+                        filter.dateFrom = BASE_DATE + random() % SPAN;
+                        filter.dateTo = filter.dateFrom + 86400 * (1 + random() % 30);
+                        for (const auto& tx : repo->find(filter)) {
+                            CHECK(tx.categoryId == filter.categoryId && !tx.isDeleted &&
+                                  tx.date >= filter.dateFrom && tx.date <= filter.dateTo);
+                        }
+                        break;
+                    }
+                    case 3: {
+                        DateRange range{BASE_DATE + static_cast<time_t>(random() % (SPAN / 2)),
+                                        BASE_DATE + SPAN / 2 + static_cast<time_t>(random() % (SPAN / 2))};
+                        stats->getTotalIncome(range, ExecutionMode::PARALLEL);
+                        stats->categoryBreakdown(range);
+                        stats->calculateMonthlyTotals(range);
+                        break;
+                    }
+                    case 4:
+                        CHECK(!io->exportToCSV().empty());
+                        notifications->checkThresholds();
+                        break;
+                    default:
+                        if (view->size() > 0) {
+                            Transaction tx = view->at(random() % view->size());
+                            if (!tx.isDeleted) {
+                                try {
+                                    repo->getById(tx.id);
+                                } catch (const std::exception&) {
+                                    // removed since the view was taken
+                                }
+                            }
+                        }
+                        break;
+                }
+                if (random() % 8 == 0) {
+                    released[r].push_back(view);
+                }
+                ++reads;
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(digest(*pinned) == pinnedDigest);
+    pinned.reset();
+
+    // Quiescent: incremental statistics match a fresh computation, and the
+    // storage reloads to the same rows
+    DateRange all{0, 0};
+    CHECK(stats->getTotalExpense(all) == repo->sumAmounts(0, 0, TransactionType::EXPENSE).sum);
+    DateRange range{BASE_DATE + 10 * 86400, BASE_DATE + 100 * 86400};
+    StatisticsService fresh(repo);
+    CHECK(fresh.getTotalIncome(range) == stats->getTotalIncome(range));
+    CHECK(fresh.categoryBreakdown(range) == stats->categoryBreakdown(range));
+    size_t live = repo->count();
+    CHECK(TransactionRepository(storage).count() == live);
+
+    // With the services gone, only the latest view may still be alive
+    stats.reset();
+    notifications.reset();
+    io.reset();
+    auto latest = repo->snapshot();
+    size_t sampled = 0, alive = 0;
+    for (const auto& views : released) {
+        for (const auto& weak : views) {
+            ++sampled;
+            auto view = weak.lock();
+            if (view && view != latest) {
+                ++alive;
+            }
+        }
+    }
+    CHECK(alive == 0);
+
+    std::printf("adds=%ld updates=%ld removes=%ld batches=%ld reads=%ld live=%zu "
+                "version=%llu views sampled=%zu leaked=%zu failures=%ld\n",
+                adds.load(), updates.load(), removes.load(), batches.load(), reads.load(), live,
+                static_cast<unsigned long long>(latest->version()), sampled, alive, failures.load());
+    return failures == 0 ? 0 : 1;
+}
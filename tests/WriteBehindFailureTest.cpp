@@ -0,0 +1,142 @@
+// Checks FileStorage's write-behind failure paths: an append that fails
+// partway is retried without repeating the bytes that reached the file, and
+// a key removed while the flusher is writing it stays removed when that
+// write fails. POSIX only: a file size limit cuts the append short, and a
+// FIFO in place of the temp file holds the flusher mid-write.
+//
+// Build and run from the project root:
+//   g++ -std=c++17 -O1 -g -fsanitize=address,undefined -pthread tests/WriteBehindFailureTest.cpp $(ls src/*.cpp | grep -v main.cpp) -o write_behind_failure
+//   ./write_behind_failure
+
+#include "../include/storage/FileStorage.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            ++failures;                                                               \
+            std::fprintf(stderr, "FAIL %s:%d %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                             \
+    } while (0)
+
+std::string readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void setFileSizeLimit(rlim_t bytes) {
+    rlimit limit;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    limit.rlim_cur = bytes;
+    setrlimit(RLIMIT_FSIZE, &limit);
+}
+
+void testPartialAppend(const fs::path& dir) {
+    fs::remove_all(dir);
+    FileStorage storage(dir.string(), WriteMode::BEHIND);
+    storage.append("log.wal", std::string(100, 'a'));
+    storage.flush();
+
+    // Only 40 of the next 100 bytes fit before the write fails
+    storage.append("log.wal", std::string(100, 'b'));
+    setFileSizeLimit(140);
+    bool threw = false;
+    try {
+        storage.flush();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    setFileSizeLimit(RLIM_INFINITY);
+    CHECK(threw);
+    CHECK(fs::file_size(dir / "log.wal") == 100);
+
+    storage.append("log.wal", std::string(100, 'c'));
+    storage.flush();
+    CHECK(readFile(dir / "log.wal") == std::string(100, 'a') + std::string(100, 'b') + std::string(100, 'c'));
+}
+
+void testRemoveDuringFailedWrite(const fs::path& dir) {
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    fs::path fifo = dir / "value.dat.tmp";
+    mkfifo(fifo.c_str(), 0644);
+
+    {
+        FileStorage storage(dir.string(), WriteMode::BEHIND);
+        storage.setFlushDelay(std::chrono::milliseconds(0));
+        storage.save("value.dat", "stale");
+        // The flusher now blocks opening the FIFO; give it time to get there
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        std::thread remover([&] { storage.remove("value.dat"); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        // Let the flusher's open succeed and its write fail
+        int reader = ::open(fifo.c_str(), O_RDONLY);
+        ::close(reader);
+        remover.join();
+
+        // A retried write would block on the FIFO again; a reader lets it
+        // through, so it shows up as a recreated file
+        int drain = ::open(fifo.c_str(), O_RDONLY | O_NONBLOCK);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        ::close(drain);
+        std::error_code error;
+        fs::remove(fifo, error);
+        try {
+            storage.flush();
+        } catch (const std::runtime_error&) {
+            CHECK(false);
+        }
+        bool recreated = fs::exists(dir / "value.dat");
+        CHECK(!recreated);
+        if (recreated) {
+            fs::remove(dir / "value.dat");   // reading the FIFO would block
+        } else {
+            CHECK(!storage.exists("value.dat"));
+            CHECK(storage.load("value.dat").empty());
+        }
+
+        // A save after the removal still counts
+        storage.save("value.dat", "fresh");
+        storage.flush();
+    }
+    CHECK(readFile(dir / "value.dat") == "fresh");
+}
+
+} // namespace
+
+int main() {
+    // Failed writes should report EFBIG and EPIPE, not end the process
+    std::signal(SIGXFSZ, SIG_IGN);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    fs::path base = fs::temp_directory_path() / "write_behind_failure_test";
+    testPartialAppend(base.string() + "_append");
+    testRemoveDuringFailedWrite(base.string() + "_remove");
+    fs::remove_all(base.string() + "_append");
+    fs::remove_all(base.string() + "_remove");
+
+    std::printf("failures=%d\n", failures);
+    return failures == 0 ? 0 : 1;
+}